@@ -1,8 +1,14 @@
 #include "Players.h"
+#include "state_encoding.h"
 #include <stdexcept>
 #include <iomanip>
 #include <iostream>
-#include <map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory_resource>
+#include <numeric>
+#include <unordered_set>
 
 namespace app {
 static const int MILLISECONDS_IN_SECOND = 1000;
@@ -49,14 +55,17 @@ Token PlayerTokens::GenerateToken() {
 }
 
 Token PlayerTokens::AddPlayer(std::shared_ptr<Player> playerPtr) {
-    Token token = GenerateToken();
-    if(auto [it, inserted] = token_to_player_.emplace(token, playerPtr); !inserted) {
-        return AddPlayer(playerPtr);
+    std::unique_lock lock{mutex_};
+    for(;;) {
+        Token token = GenerateToken();
+        if(auto [it, inserted] = token_to_player_.emplace(token, playerPtr); inserted) {
+            return token;
+        }
     }
-    return token;
 }
 
 void PlayerTokens::DeletePlayer(std::shared_ptr<Player> playerPtr) {
+    std::unique_lock lock{mutex_};
     for(auto& data : token_to_player_) {
         if(auto& [token, player] = data; playerPtr->GetId() == player->GetId()) {
             token_to_player_.erase(token);
@@ -66,8 +75,9 @@ void PlayerTokens::DeletePlayer(std::shared_ptr<Player> playerPtr) {
 }
 
 std::shared_ptr<Player> PlayerTokens::FindPlayerByToken(Token token) {
-    if(token_to_player_.contains(token)) {
-        return token_to_player_[token];
+    std::shared_lock lock{mutex_};
+    if(auto it = token_to_player_.find(token); it != token_to_player_.end()) {
+        return it->second;
     }
     return nullptr;
 }
@@ -81,9 +91,14 @@ json::object Application::ConnectToGame(std::string user_name, std::string map_i
     auto dog_id = model::DogsId::GetDogId();
     std::shared_ptr<model::Dog> dog = std::make_shared<model::Dog>(model::Dog::Id{dog_id}, user_name);
     // Получаем сессию
+    if(auto session = game_.FindSession(model::Map::Id{map_id})) {
+        WakeSession(*session);
+    }
     auto sessionPtr =  game_.ConnectToSession(model::Map::Id{map_id}, dog, is_random_);
     // Создаем игрока
     auto playerPtr = players_->Add(dog, sessionPtr);
+    // Новый игрок сразу виден в ответах на запросы чтения
+    sessionPtr->PublishSnapshot();
     std::string token = *tokens_->AddPlayer(playerPtr);
     size_t player_id = *playerPtr->GetId();
     // Генерируем ответ
@@ -91,21 +106,25 @@ json::object Application::ConnectToGame(std::string user_name, std::string map_i
     return obj;
 }
 
-json::object Application::GetPlayers(std::string _token) {
+ResponseBody Application::GetPlayers(std::string _token) {
     Token token {_token};
 
     auto player  = tokens_->FindPlayerByToken(token);
     if(!player) {
-        return json::object {{"code", "unknownToken"}, {"message", "Player token has not been found"}};
+        return nullptr;
     }
-    auto session = player->GetSession();
-    auto dogs    = session->GetDogs();
+    auto snapshot = player->GetSession()->GetSnapshot();
+    return GetSessionBodies(*player->GetSession()).players.Get(snapshot->roster_version, [&snapshot] {
+        return json::serialize(BuildPlayers(*snapshot));
+    });
+}
 
+json::object Application::BuildPlayers(const model::SessionSnapshot& snapshot) {
     json::object obj;
-    for(auto dog : *dogs) {
+    for(const auto& dog : snapshot.dogs) {
         json::object dogObj;
-        dogObj["name"] = dog->GetName();
-        obj[std::to_string(*dog->GetId())] = dogObj;
+        dogObj["name"] = dog.name;
+        obj[std::to_string(*dog.id)] = dogObj;
     }
 
     return obj;
@@ -128,69 +147,180 @@ json::array Application::GetRecords(int start, int max_items) {
 }
 
 
-json::object Application::GetState(std::string _token) {
-    json::object result;
+ResponseBody Application::GetState(std::string _token) {
     Token token {_token};
 
     auto player  = tokens_->FindPlayerByToken(token);
     if(!player) {
-        return json::object {{"code", "unknownToken"}, {"message", "Player token has not been found"}};
+        return nullptr;
+    }
+    // Ответ строится по снимку сессии на конец последнего тика
+    auto snapshot = player->GetSession()->GetSnapshot();
+    return GetSessionBodies(*player->GetSession()).state.Get(snapshot->version, [&snapshot] {
+        return json::serialize(BuildState(*snapshot));
+    });
+}
+
+ResponseBody Application::GetStateBinary(std::string _token) {
+    Token token {_token};
+
+    auto player  = tokens_->FindPlayerByToken(token);
+    if(!player) {
+        return nullptr;
+    }
+    auto snapshot = player->GetSession()->GetSnapshot();
+    return GetSessionBodies(*player->GetSession()).state_binary.Get(snapshot->version, [&snapshot] {
+        std::string body;
+        EncodeStateBinary(*snapshot, body);
+        return body;
+    });
+}
+
+Application::SessionBodies& Application::GetSessionBodies(const model::GameSession& session) {
+    {
+        std::shared_lock lock{bodies_mutex_};
+        if(auto it = session_bodies_.find(&session); it != session_bodies_.end()) {
+            return *it->second;
+        }
+    }
+    std::unique_lock lock{bodies_mutex_};
+    auto& bodies = session_bodies_[&session];
+    if(!bodies) {
+        bodies = std::make_unique<SessionBodies>();
     }
-    auto session = player->GetSession();
-    auto dogs    = session->GetDogs();
+    return *bodies;
+}
+
+json::object Application::DogToJson(const model::SessionSnapshot::DogInfo& dog) {
+    json::object dogObj;
+    json::array bagArray;
+
+    dogObj["pos"]   = boost::json::array{dog.pos.x, dog.pos.y};
+    dogObj["speed"] = boost::json::array{dog.speed.horizont, dog.speed.vertical};
+    dogObj["dir"]   = model::DirectionToString(dog.dir);
+
+    for(const auto& item : dog.bag) {
+        json::object bagItem;
+        bagItem["id"]   = item.first;
+        bagItem["type"] = item.second;
+        bagArray.push_back(bagItem);
+    }
+    dogObj["bag"]   = std::move(bagArray);
+    dogObj["score"] = dog.score;
+    return dogObj;
+}
+
+json::object Application::LootToJson(const model::LostObjects::Object& loot) {
+    json::object lootObj;
+    lootObj["type"] = loot.type;
+    lootObj["pos"]  = boost::json::array{loot.pos.x, loot.pos.y};
+    return lootObj;
+}
+
+json::object Application::BuildState(const model::SessionSnapshot& snapshot) {
+    json::object result;
 
     // Получение информации об игроках
     {
-        json::object players;
         json::object data;
-        for(auto dog : *dogs) {
-            json::object dogObj;
-            json::array bagArray;
-            
-            auto pos   = dog->GetPos();
-            auto speed = dog->GetSpeed();
-            auto dir   = dog->GetDir();
-    
-            dogObj["pos"]   = boost::json::array{pos.x, pos.y};
-            dogObj["speed"] = boost::json::array{speed.horizont, speed.vertical};
-            dogObj["dir"]   = dir;
-
-            auto itemsInBag = dog->GetBagObjects();
-            for(auto item : itemsInBag) {
-                json::object bagItem;
-                bagItem["id"]   = item.first;
-                bagItem["type"] = item.second;
-                bagArray.push_back(bagItem);
-            }
-            dogObj["bag"] = std::move(bagArray);
-            
-            size_t score = dog->GetScore();
-            dogObj["score"] = score;
-
-            data[std::to_string(*dog->GetId())] = std::move(dogObj);
+        for(const auto& dog : snapshot.dogs) {
+            data[std::to_string(*dog.id)] = DogToJson(dog);
         }
-
         result["players"] = std::move(data);
     }
 
     // Получение списка потерянных предметов
     {
         json::object data;
-        auto loot_objects = session->GetLootObjects();
-        for(auto loot : loot_objects) {
-            json::object lootObj;
+        for(const auto& loot : snapshot.loot) {
+            data[std::to_string(loot.id)] = LootToJson(loot);
+        }
+        result["lostObjects"] = std::move(data);
+    }
 
-            size_t id   = std::get<0>(loot);
-            auto pos    = std::get<1>(loot);
-            size_t type = std::get<2>(loot);
+    return result;
+}
 
-            lootObj["type"] = type;
-            lootObj["pos"]  = boost::json::array{pos.x, pos.y};
+VersionedResponse Application::GetStateSince(std::string _token, std::uint64_t since) {
+    Token token {_token};
 
-            data[std::to_string(id)] = lootObj;
+    auto player  = tokens_->FindPlayerByToken(token);
+    if(!player) {
+        return {};
+    }
+    const auto& session = player->GetSession();
+    auto current = session->GetSnapshot();
+    auto& bodies = GetSessionBodies(*session);
+
+    // Клиенты, успевающие за тиками, запрашивают изменения последнего тика, поэтому они кэшируются
+    auto base = since != 0 && since <= current->version ? session->GetSnapshot(since) : nullptr;
+    if(!base) {
+        return {bodies.full_state.Get(current->version, [&current] {
+            json::object result = BuildState(*current);
+            result["tick"] = current->version;
+            result["full"] = true;
+            return json::serialize(result);
+        }), current->version};
+    }
+    if(since + 1 == current->version) {
+        return {bodies.last_delta.Get(current->version, [&base, &current] {
+            return json::serialize(BuildDelta(*base, *current));
+        }), current->version};
+    }
+    return {std::make_shared<const std::string>(json::serialize(BuildDelta(*base, *current))), current->version};
+}
+
+json::object Application::BuildDelta(const model::SessionSnapshot& base, const model::SessionSnapshot& current) {
+    json::object result;
+    result["tick"] = current.version;
+    result["full"] = false;
+
+    // Собаки и предметы могут поменять порядок в снимке, поэтому сопоставляются по id
+    {
+        std::unordered_map<size_t, const model::SessionSnapshot::DogInfo*> base_dogs;
+        base_dogs.reserve(base.dogs.size());
+        for(const auto& dog : base.dogs) {
+            base_dogs.emplace(*dog.id, &dog);
         }
 
-        result["lostObjects"] = std::move(data);
+        json::object changed;
+        for(const auto& dog : current.dogs) {
+            auto it = base_dogs.find(*dog.id);
+            if(it == base_dogs.end() || !(*it->second == dog)) {
+                changed[std::to_string(*dog.id)] = DogToJson(dog);
+            }
+            if(it != base_dogs.end()) {
+                base_dogs.erase(it);
+            }
+        }
+        json::array removed;
+        for(const auto& [id, dog] : base_dogs) {
+            removed.emplace_back(std::to_string(id));
+        }
+        result["players"]        = std::move(changed);
+        result["removedPlayers"] = std::move(removed);
+    }
+
+    // Предметы не меняются, пока лежат на карте, а их id не используются повторно
+    {
+        std::unordered_set<model::LostObjects::Id> base_loot;
+        base_loot.reserve(base.loot.size());
+        for(const auto& loot : base.loot) {
+            base_loot.insert(loot.id);
+        }
+
+        json::object added;
+        for(const auto& loot : current.loot) {
+            if(!base_loot.erase(loot.id)) {
+                added[std::to_string(loot.id)] = LootToJson(loot);
+            }
+        }
+        json::array removed;
+        for(const auto id : base_loot) {
+            removed.emplace_back(std::to_string(id));
+        }
+        result["lostObjects"]        = std::move(added);
+        result["removedLostObjects"] = std::move(removed);
     }
 
     return result;
@@ -203,193 +333,397 @@ json::object Application::Move(std::string _token, std::string_view dir) {
     if(!player) {
         return json::object {{"code", "unknownToken"}, {"message", "Player token has not been found"}};
     }
-    auto session = player->GetSession();
-    auto dog     = player->GetDog();
-    auto map     = session->GetMap();
-    double speed = map.GetDogSpeed();
 
-    dog->SetDir(dir, speed);
+    if(auto direction = model::ParseDirection(dir)) {
+        auto session = player->GetSession();
+        actions_.Push(MoveAction{std::move(player), *direction});
+        // Без таймера команды приходят через strand, поэтому применяются и публикуются сразу
+        if(!is_tick_) {
+            ApplyActions();
+            if(session->PublishSnapshot() && publish_listener_) {
+                publish_listener_();
+            }
+        }
+    }
     
     return json::object{};
 }
 
+void Application::ApplyActions() {
+    drained_actions_.clear();
+    actions_.Drain(drained_actions_);
+
+    // Применяется только последняя команда каждой собаки. Команды группируются по собакам,
+    // последняя команда собаки встаёт первой в группе, а остальные помечаются пустым игроком
+    for(size_t i = 0; i < drained_actions_.size(); ++i) {
+        drained_actions_[i].sequence = i;
+    }
+    std::sort(drained_actions_.begin(), drained_actions_.end(), [](const MoveAction& l, const MoveAction& r) {
+        const model::Dog* l_dog = l.player->GetDog().get();
+        const model::Dog* r_dog = r.player->GetDog().get();
+        return l_dog != r_dog ? std::less<>{}(l_dog, r_dog) : l.sequence > r.sequence;
+    });
+    const model::Dog* prev_dog = nullptr;
+    for(auto& action : drained_actions_) {
+        const model::Dog* dog = action.player->GetDog().get();
+        if(dog == prev_dog) {
+            action.player.reset();
+        }
+        prev_dog = dog;
+    }
+    // Оставшиеся команды применяются в порядке поступления, как без объединения
+    std::sort(drained_actions_.begin(), drained_actions_.end(), [](const MoveAction& l, const MoveAction& r) {
+        return l.sequence < r.sequence;
+    });
+
+    for(const auto& action : drained_actions_) {
+        if(!action.player) {
+            continue;
+        }
+        const auto& session = action.player->GetSession();
+        const auto& dog     = action.player->GetDog();
+        // Собака могла уйти из игры, пока команда ждала в очереди
+        if(!session->HasDog(*dog)) {
+            continue;
+        }
+        WakeSession(*session);
+        session->SetDogDir(*dog, action.direction);
+    }
+    drained_actions_.clear();
+}
+
 model::Game& Application::GetGameObj() {
     return game_;
 }
 
 void Application::Tick(std::chrono::milliseconds timer) {
-    int delta = timer.count();
-    Tick(delta);
+    ApplyActions();
+    if(!clock_) {
+        Step(timer.count());
+    } else {
+        clock_->Advance(timer, [this](std::chrono::milliseconds step) {
+            Step(step.count());
+        });
+    }
+    PublishSnapshots();
 }
 
-void Application::Tick(const int delta) const {
-    auto sessions = game_.GetSessions();
-    for(auto session : sessions) {
-        std::vector<collision_detector::Gatherer> gatherers;
-        std::vector<collision_detector::Item> items;
-
-        auto map   = session->GetMap();
-        auto roads = map.GetRoads();
-        auto dogs  = *session->GetDogs();
+void Application::Tick(const int delta) {
+    ApplyActions();
+    if(!clock_) {
+        Step(delta);
+    } else {
+        clock_->AdvanceExactly(std::chrono::milliseconds{delta}, [this](std::chrono::milliseconds step) {
+            Step(step.count());
+        });
+    }
+    PublishSnapshots();
+}
 
-        for(auto dog : dogs) {
-            // Расчет новой позиции   
-            CalcNewPos(dog, roads, gatherers, delta);
-            // Проверка неактивных пользователей
-            CheckPlayerDisconnect(dog, delta);
+void Application::PublishSnapshots() const {
+    const auto& sessions = game_.GetSessions();
+    std::atomic<bool> published{false};
+    if(tick_workers_ && sessions.size() > 1) {
+        tick_workers_->ForEach(sessions.size(), [&sessions, &published](size_t i) {
+            if(sessions[i]->PublishSnapshot()) {
+                published.store(true, std::memory_order_relaxed);
+            }
+        });
+    } else {
+        for(const auto& session : sessions) {
+            if(session->PublishSnapshot()) {
+                published.store(true, std::memory_order_relaxed);
+            }
         }
+    }
+    // Подписчики оповещаются, только если изменилась хотя бы одна сессия
+    if(published.load(std::memory_order_relaxed) && publish_listener_) {
+        publish_listener_();
+    }
+}
 
-        // Генерирование потерянных предметов
-        size_t loot_count   = session->LootCount();
-        size_t looter_count = session->DogsCount();        
-
-        size_t generate_count = game_.LootGenerate(std::chrono::milliseconds(delta), loot_count, looter_count);
-        for(size_t i = 0; i < generate_count; i++) {
-            session->AddLoot();
-        }
+void Application::SetPublishListener(std::function<void()> listener) {
+    publish_listener_ = std::move(listener);
+}
 
-        auto lost_objects = session->GetLootObjects();
-        for(auto lost_object : lost_objects) {
-            collision_detector::Item item;
-            auto coord = std::get<1>(lost_object);
-            item.position = geom::Point2D(coord.x, coord.y);
-            item.width = 0.0;
-            items.emplace_back(item);
-        }
+void Application::SetSimulationStep(std::chrono::milliseconds step) {
+    clock_.emplace(step, MAX_STEPS_PER_TICK);
+}
 
-        auto offices = map.GetOffices();
-        for(auto office : offices) {
-            collision_detector::Item item;
-            auto coord = office.GetPosition();
-            item.position = geom::Point2D(coord.x, coord.y);
-            item.width = 0.25;
-            items.emplace_back(item);
-        }
+SimulationClock::Stats Application::GetTickStats() const {
+    return clock_ ? clock_->GetStats() : SimulationClock::Stats{};
+}
 
-        // Обработка коллизий
-        std::map<size_t, bool> uses_items;  // Отмечаем подобранные предметы
-        auto events = FindGatherEvents(VectorItemGathererProvider{items, gatherers});
-        for(auto event : events) {
-            size_t gatherer_id = event.gatherer_id;
-            size_t item_id     = event.item_id;
+void Application::Step(const int delta) const {
+    const auto& sessions = game_.GetSessions();
+    // Сессии только добавляются, поэтому буферы сессии остаются под её индексом
+    if(tick_buffers_.size() < sessions.size()) {
+        tick_buffers_.resize(sessions.size());
+    }
 
-            bool is_lost_item = item_id < events.size(); // true - потерянный предмет, false - оффис
-            auto dog = dogs[gatherer_id];
+    // Сессии не разделяют изменяемых данных и обновляются независимо.
+    // Крупные сессии раздаются первыми, чтобы последними потоки получали короткие задачи
+    if(tick_workers_ && sessions.size() > 1) {
+        tick_order_.resize(sessions.size());
+        std::iota(tick_order_.begin(), tick_order_.end(), size_t{0});
+        // Равные по размеру сессии остаются в порядке индексов
+        std::sort(tick_order_.begin(), tick_order_.end(), [&sessions](size_t l, size_t r) {
+            const size_t l_dogs = sessions[l]->DogsCount();
+            const size_t r_dogs = sessions[r]->DogsCount();
+            return l_dogs != r_dogs ? l_dogs > r_dogs : l < r;
+        });
+        tick_workers_->ForEach(sessions.size(), [&](size_t i) {
+            const size_t index = tick_order_[i];
+            UpdateSession(*sessions[index], tick_buffers_[index], delta);
+        });
+    } else {
+        for(size_t i = 0; i < sessions.size(); ++i) {
+            UpdateSession(*sessions[i], tick_buffers_[i], delta);
+        }
+    }
 
-            // Подбираем потерянный предмет
-            if(is_lost_item && dog->GetItemsCount() < map.GetBagCapacity() && !uses_items.contains(item_id)) {
-                auto lost_object = lost_objects[item_id];
+    // Удаление неактивных игроков меняет общие таблицы игроков и токенов, поэтому идёт последовательно
+    for(const auto& session : sessions) {
+        CheckPlayerDisconnect(session);
+    }
+}
 
-                size_t id   = std::get<0>(lost_object);
-                size_t type = std::get<2>(lost_object);
-                size_t score = map.GetScoreLootType(type);
+void Application::UpdateSession(model::GameSession& session, TickBuffers& buffers, const int delta) const {
+    if(session.IsEventDriven()) {
+        AdvanceSession(session, delta);
+        return;
+    }
+    // Бездействующая сессия копит время и обновляется одним шагом раз в idle_tick_period_.
+    // Собаки в ней стоят на месте, поэтому один длинный шаг равносилен нескольким коротким
+    if(idle_tick_period_ && session.GetDogStates().IsIdle()) {
+        session.DeferTime(delta);
+        if(session.GetDeferredTime() >= *idle_tick_period_) {
+            TickSession(session, buffers, session.TakeDeferredTime());
+        }
+        return;
+    }
+    TickSession(session, buffers, session.TakeDeferredTime() + delta);
+}
 
-                // Добавляем предмет в рюкзак
-                dog->AddItem(id, type, score);
-                uses_items[item_id] = true;
+void Application::AdvanceSession(model::GameSession& session, const int delta) const {
+    const auto& map = session.GetMap();
+    auto dogs = session.GetDogs();
 
-                // Удаляем предмет с карты
-                session->DeliteLoot(id);
-            }
-            
-            // Сдать все предметы на базу
-            if(!is_lost_item) {
+    // Обрабатываются только наступившие события, собаки между ними не перемещаются
+    const std::int64_t until = session.GetTime() + delta;
+    while(auto event = session.NextGatherEvent(until)) {
+        const auto& dog = dogs[event->slot];
+        if(event->type == model::MotionEventType::OFFICE) {
+            if(dog->GetItemsCount() > 0) {
                 dog->FreeItems();
+                session.MarkChanged();
             }
+            continue;
+        }
+        // Предмет мог подобрать другой пёс
+        const auto* lost_object = session.FindLoot(event->target);
+        if(lost_object && dog->GetItemsCount() < map.GetBagCapacity()) {
+            dog->AddItem(lost_object->id, lost_object->type, map.GetScoreLootType(lost_object->type));
+            session.DeliteLoot(lost_object->id);
         }
     }
+
+    // Предметы появляются в конце тика, их подбор предсказывается для движущихся собак
+    session.GenerateLoot(std::chrono::milliseconds(delta));
 }
 
-void Application::CalcNewPos(std::shared_ptr<model::Dog> dog, model::Map::Roads& roads, std::vector<collision_detector::Gatherer>& gatherers, const int delta) const {
-    
-    collision_detector::Gatherer gatherer;
-    auto speed = dog->GetSpeed();
-    auto pos   = dog->GetPos();
-    gatherer.start_pos = geom::Point2D(pos.x, pos.y);
-    gatherer.width = 0.3d;
-    
-    double x = pos.x + (speed.horizont * delta / MILLISECONDS_IN_SECOND);
-    double y = pos.y + (speed.vertical * delta / MILLISECONDS_IN_SECOND);
-
-    model::Coordinate cur_pos{pos.x, pos.y};  
-    model::Coordinate new_pos{pos.x, pos.y};
-    const double road_width = 0.4;        
-
-    for(auto road : roads) {
-        auto start = road.GetStart();
-        auto end   = road.GetEnd();
-        double tmp;
-        if (start.x > end.x) {
-            auto temp = start.x;
-            start.x = end.x;
-            end.x = temp;
+void Application::WakeSession(model::GameSession& session) const {
+    // Отложенное время моделируется до изменения сессии, пока её собаки ещё стоят на месте
+    if(const int deferred = session.TakeDeferredTime(); deferred > 0) {
+        TickSession(session, wake_buffers_, deferred);
+    }
+}
+
+void Application::SetIdleTickPeriod(std::chrono::milliseconds period) {
+    idle_tick_period_ = static_cast<int>(period.count());
+}
+
+void Application::TickSession(model::GameSession& session, TickBuffers& buffers, const int delta) const {
+    auto& gatherers = buffers.gatherers;
+    auto& items     = buffers.items;
+    // Временные данные тика берутся из арены и освобождаются следующим сбросом
+    std::pmr::memory_resource* arena = buffers.arena.Reset();
+
+    items.clear();
+
+    // Стоящие собаки не меняют позиций, а появление и подбор предметов сессия отмечает сама
+    if(!session.GetDogStates().IsIdle()) {
+        session.MarkChanged();
+    }
+
+    // Крупная сессия делится на полосы карты, собаки каждой полосы обновляются отдельной задачей
+    const size_t regions_count = RegionsCount(session);
+    if(regions_count > 1) {
+        session.SplitIntoRegions(regions_count);
+        session.RegroupDogs();
+    }
+
+    const auto& map = session.GetMap();
+    auto dogs = session.GetDogs();
+    const std::array<size_t, 2> all_dogs{0, dogs.size()};
+    const std::span<const size_t> offsets = regions_count > 1 ? session.GetRegionOffsets() : std::span<const size_t>{all_dogs};
+    const size_t regions = offsets.size() - 1;
+    if(buffers.regions.size() < regions) {
+        buffers.regions.resize(regions);
+    }
+    // fn(region, begin, end) вызывается для каждой полосы
+    const auto for_each_region = [&](auto&& fn) {
+        if(regions > 1) {
+            tick_workers_->ForEach(regions, [&](size_t r) {
+                fn(r, offsets[r], offsets[r + 1]);
+            });
+        } else {
+            fn(0, offsets[0], offsets[1]);
         }
-        if (start.y > end.y) {
-            auto temp = start.y;
-            start.y = end.y;
-            end.y = temp;
+    };
+
+    // Расчет новых позиций
+    gatherers.resize(dogs.size());
+    for_each_region([&](size_t, size_t begin, size_t end) {
+        CalcNewPos(session, gatherers, delta, begin, end);
+    });
+
+    // Генерирование потерянных предметов
+    session.GenerateLoot(std::chrono::milliseconds(delta));
+
+    // Представление предметов действительно до конца обработки коллизий: подобранные удаляются после неё
+    auto lost_objects = session.GetLootObjects();
+    for(const auto& lost_object : lost_objects) {
+        collision_detector::Item item;
+        item.position = geom::Point2D(lost_object.pos.x, lost_object.pos.y);
+        item.width = 0.0;
+        items.emplace_back(item);
+    }
+    buffers.loot_index.Rebuild(items);
+
+    // Поиск столкновений. Офисы проиндексированы картой
+    for_each_region([&](size_t r, size_t begin, size_t end) {
+        auto& region = buffers.regions[r];
+        const std::span<const collision_detector::Gatherer> region_gatherers{gatherers.data() + begin, end - begin};
+        FindGatherEvents(buffers.loot_index, region_gatherers, region.loot_events, region.scratch);
+        FindGatherEvents(map.GetOfficeIndex(), region_gatherers, region.office_events, region.scratch);
+    });
+    const auto& loot_events   = MergeRegionEvents(buffers, offsets, dogs, &RegionBuffers::loot_events, buffers.loot_events);
+    const auto& office_events = MergeRegionEvents(buffers, offsets, dogs, &RegionBuffers::office_events, buffers.office_events);
+
+    // Обработка событий обоих видов по времени.
+    // Подобранные предметы отмечаются в битовом множестве по их индексам в lost_objects
+    std::pmr::vector<std::uint64_t> picked_items((lost_objects.size() + 63) / 64, 0, arena);
+    std::pmr::vector<model::LostObjects::Id> picked_loot{arena};
+    picked_loot.reserve(std::min(lost_objects.size(), loot_events.size()));
+    size_t loot_event_idx = 0, office_event_idx = 0;
+    while(loot_event_idx < loot_events.size() || office_event_idx < office_events.size()) {
+        // true - потерянный предмет, false - оффис
+        bool is_lost_item = office_event_idx == office_events.size() ||
+                            (loot_event_idx < loot_events.size() &&
+                             loot_events[loot_event_idx].time <= office_events[office_event_idx].time);
+        const auto& event = is_lost_item ? loot_events[loot_event_idx++] : office_events[office_event_idx++];
+        size_t gatherer_id = event.gatherer_id;
+        size_t item_id     = event.item_id;
+
+        const auto& dog = dogs[gatherer_id];
+
+        // Подбираем потерянный предмет
+        const std::uint64_t item_bit = std::uint64_t{1} << (item_id % 64);
+        if(is_lost_item && dog->GetItemsCount() < map.GetBagCapacity() && !(picked_items[item_id / 64] & item_bit)) {
+            const auto& lost_object = lost_objects[item_id];
+            size_t score = map.GetScoreLootType(lost_object.type);
+
+            // Добавляем предмет в рюкзак
+            dog->AddItem(lost_object.id, lost_object.type, score);
+            picked_items[item_id / 64] |= item_bit;
+            picked_loot.emplace_back(lost_object.id);
         }
         
-        if ((start.x - road_width) <= pos.x && (end.x + road_width) >= pos.x && (start.y - road_width) <= pos.y && (end.y + road_width) >= pos.y) {
-            if (speed.horizont > 0) {
-                tmp = new_pos.x;
-                if(road.IsHorizontal()) {
-                    new_pos.x = x < (end.x + road_width) ? x : (end.x + road_width);
-                } else {
-                    new_pos.x = x < (start.x + road_width) ? x : (start.x + road_width);
-                }
-                new_pos.x = new_pos.x > tmp ? new_pos.x : tmp;
-            } else if (speed.horizont < 0) {
-                tmp = new_pos.x;
-                if(road.IsHorizontal()) {
-                    new_pos.x = x > (start.x - road_width) ? x : (start.x - road_width);
-                } else {
-                    new_pos.x = x > (start.x - road_width) ? x : (start.x - road_width);
-                }
-                new_pos.x = new_pos.x < tmp ? new_pos.x : tmp;
-            } else if (speed.vertical > 0) {
-                tmp = new_pos.y;
-                if(road.IsHorizontal()) {
-                    new_pos.y = y < (start.y + road_width) ? y : (start.y + road_width);
-                } else {
-                    new_pos.y = y < (end.y + road_width) ? y : (end.y + road_width);
-                }
-                new_pos.y = new_pos.y > tmp ? new_pos.y : tmp;
-            } else if (speed.vertical < 0) {
-                tmp = new_pos.y;
-                if(road.IsHorizontal()) {
-                    new_pos.y = y > (start.y - road_width) ? y : (start.y - road_width);
-                } else {
-                    new_pos.y = y > (start.y - road_width) ? y : (start.y - road_width);
-                }
-                new_pos.y = new_pos.y < tmp ? new_pos.y : tmp;
-            }
+        // Сдать все предметы на базу
+        if(!is_lost_item && dog->GetItemsCount() > 0) {
+            dog->FreeItems();
+            session.MarkChanged();
         }
     }
 
-    if (cur_pos.x == new_pos.x && cur_pos.y == new_pos.y) {
-        dog->SetSpeed(model::Speed{0.0, 0.0});
+    // Удаляем подобранные предметы с карты
+    for(auto id : picked_loot) {
+        session.DeliteLoot(id);
     }
+}
 
-    dog->SetPos(new_pos);
-    gatherer.end_pos = geom::Point2D(new_pos.x, new_pos.y);
-    gatherers.emplace_back(gatherer);
+size_t Application::RegionsCount(const model::GameSession& session) const {
+    if(!tick_workers_) {
+        return 1;
+    }
+    // Полос больше, чем потоков, чтобы освободившиеся потоки забирали полосы у перегруженных
+    const size_t by_threads = REGIONS_PER_THREAD * (tick_workers_->ThreadsCount() + 1);
+    const size_t by_dogs    = session.DogsCount() / MIN_DOGS_PER_REGION;
+    return std::max<size_t>(1, std::min(by_threads, by_dogs));
 }
 
-void Application::CheckPlayerDisconnect(std::shared_ptr<model::Dog> dog, const int delta) const {
-    dog->AddPlayTime((double)delta / (double)MILLISECONDS_IN_SECOND);
-    double stop_time = dog->GetStopTime();
-    auto pos = dog->GetPos();
-    if(stop_time >= game_.GetDogRetirementTime()) {
-        double play_time = dog->GetPlayTime();
-        use_cases_.AddRetiredPLayer(dog->GetName(), dog->GetScore(), play_time);
-        auto sessions = game_.GetSessions();
-        for(auto& session : sessions) {
-            session->DeleteDog(dog);
-            auto player = players_->DeletePlayer(dog, session);
-            if(player) {
-                tokens_->DeletePlayer(player);
-            }
+const std::vector<collision_detector::GatheringEvent>& Application::MergeRegionEvents(
+        TickBuffers& buffers, std::span<const size_t> offsets, std::span<const std::shared_ptr<model::Dog>> dogs,
+        std::vector<collision_detector::GatheringEvent> RegionBuffers::*events,
+        std::vector<collision_detector::GatheringEvent>& merged) const {
+    const auto by_time_dog_item = [dogs](const collision_detector::GatheringEvent& l,
+                                         const collision_detector::GatheringEvent& r) {
+        if(l.time != r.time) {
+            return l.time < r.time;
+        }
+        if(l.gatherer_id != r.gatherer_id) {
+            return *dogs[l.gatherer_id]->GetId() < *dogs[r.gatherer_id]->GetId();
+        }
+        return l.item_id < r.item_id;
+    };
+
+    const size_t regions = offsets.size() - 1;
+    if(regions == 1) {
+        auto& region_events = buffers.regions[0].*events;
+        std::sort(region_events.begin(), region_events.end(), by_time_dog_item);
+        return region_events;
+    }
+
+    // Номера собирателей полосы отсчитываются от её первой собаки
+    merged.clear();
+    for(size_t r = 0; r < regions; ++r) {
+        for(auto event : buffers.regions[r].*events) {
+            event.gatherer_id += offsets[r];
+            merged.emplace_back(event);
+        }
+    }
+    std::sort(merged.begin(), merged.end(), by_time_dog_item);
+    return merged;
+}
+
+void Application::CalcNewPos(model::GameSession& session, std::span<collision_detector::Gatherer> gatherers,
+                             const int delta, size_t begin, size_t end) const {
+    auto& states = session.GetDogStates();
+    model::MoveDogs(states, session.GetMap().GetRoadIndex(), delta, begin, end);
+
+    for(size_t i = begin; i < end; ++i) {
+        collision_detector::Gatherer gatherer;
+        gatherer.start_pos = geom::Point2D(states.prev_x[i], states.prev_y[i]);
+        gatherer.end_pos   = geom::Point2D(states.x[i], states.y[i]);
+        gatherer.width = model::Dog::WIDTH;
+        gatherers[i] = gatherer;
+    }
+}
+
+void Application::CheckPlayerDisconnect(const std::shared_ptr<model::GameSession>& session) const {
+    const auto& states = session->GetDogStates();
+    // Обходим собак с конца: место удалённой собаки занимает последняя, которая уже проверена
+    for(size_t slot = session->DogsCount(); slot-- > 0;) {
+        if(states.stop_time[slot] < game_.GetDogRetirementTime()) {
+            continue;
+        }
+        std::shared_ptr<model::Dog> dog = session->GetDogs()[slot];
+        use_cases_.AddRetiredPLayer(dog->GetName(), dog->GetScore(), states.play_time[slot]);
+        session->DeleteDog(dog);
+        auto player = players_->DeletePlayer(dog, session);
+        if(player) {
+            tokens_->DeletePlayer(player);
         }
     }
 }
@@ -5,11 +5,19 @@
 #include <sstream>
 #include <ios>
 #include <chrono>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
 #include "tagged.h"
 #include "model.h"
 #include "collision_detector.h"
 #include "geom.h"
 #include "UseCases.h"
+#include "worker_pool.h"
+#include "simulation_clock.h"
+#include "tick_arena.h"
+#include "mpsc_queue.h"
+#include "response_cache.h"
 
 
 
@@ -36,6 +44,7 @@ private:
     std::shared_ptr<model::Dog> dog_;
 };
 
+// Поиск игрока по токену можно выполнять из любого потока, в том числе одновременно с изменением таблицы
 class PlayerTokens {
     public:
         std::shared_ptr<Player> FindPlayerByToken(Token);
@@ -43,6 +52,7 @@ class PlayerTokens {
         void DeletePlayer(std::shared_ptr<Player>);
 
     private:
+        std::shared_mutex mutex_;
         std::random_device random_device_;
         std::mt19937_64 generator1_{ [this] {
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
@@ -79,22 +89,21 @@ class VectorItemGathererProvider : public collision_detector::ItemGathererProvid
 public:
     VectorItemGathererProvider(std::vector<collision_detector::Item> items,
                                std::vector<collision_detector::Gatherer> gatherers)
-        : items_(items)
-        , gatherers_(gatherers) {
+        : items_(std::move(items))
+        , gatherers_(std::move(gatherers)) {
     }
 
-    
     size_t ItemsCount() const override {
         return items_.size();
     }
     collision_detector::Item GetItem(size_t idx) const override {
-        return items_.at(idx);
+        return items_[idx];
     }
     size_t GatherersCount() const override {
         return gatherers_.size();
     }
     collision_detector::Gatherer GetGatherer(size_t idx) const override {
-        return gatherers_.at(idx);
+        return gatherers_[idx];
     }
 
 private:
@@ -109,21 +118,48 @@ public:
                 std::shared_ptr<app::Players> players,
                 bool random,
                 bool tick,
-                UseCases& use_cases)
+                UseCases& use_cases,
+                std::shared_ptr<WorkerPool> tick_workers = nullptr)
         : game_{game}
         , tokens_{tokens}
         , players_{players}
         , is_random_{random}
         , is_tick_{tick}
-        , use_cases_{use_cases} {}
+        , use_cases_{use_cases}
+        , tick_workers_{std::move(tick_workers)} {}
         
     json::object ConnectToGame(std::string user_name, std::string map_id);
-    json::object GetPlayers(std::string token);
-    json::object GetState(std::string token);
+    // Запросы чтения отвечают по снимкам сессий и могут выполняться в любом потоке одновременно с тиком.
+    // Тело ответа сериализуется один раз на снимок сессии и разделяется между всеми её игроками.
+    // Если игрок с токеном не найден, возвращают nullptr
+    ResponseBody GetPlayers(std::string token);
+    ResponseBody GetState(std::string token);
+    // То же состояние в двоичном представлении state_encoding.h
+    ResponseBody GetStateBinary(std::string token);
+    // Изменения состояния после снимка since: собаки, которые появились или изменились, новые предметы
+    // и id ушедших собак и подобранных предметов. Ответ содержит номер снимка "tick", который клиент
+    // передаёт в следующем запросе. Если снимок since уже вышел из истории сессии или since равен 0,
+    // возвращается полное состояние с признаком "full"
+    VersionedResponse GetStateSince(std::string token, std::uint64_t since);
     json::array GetRecords(int start, int max_items);
+    // Ставит команду движения в очередь и может вызываться из любого потока без strand.
+    // Команды применяются в начале тика и перед чтением состояния, из нескольких команд собаки действует последняя
     json::object Move(std::string token, std::string_view dist);
+    // Тик по таймеру. С заданным шагом моделирования время делится на шаги, а догоняние ограничено
     void Tick(std::chrono::milliseconds delta);
-    void Tick(const int delta) const;
+    // Тик по запросу /api/v1/game/tick: моделируется ровно delta миллисекунд
+    void Tick(const int delta);
+    // Включает моделирование фиксированными шагами длины step
+    void SetSimulationStep(std::chrono::milliseconds step);
+    // Включает адаптивную частоту обновления: сессия, в которой никто не движется,
+    // обновляется не чаще раза в period, а активные сессии - на каждом шаге.
+    // Промежуточных частот нет: опубликованные позиции движущейся собаки должны обновляться каждый шаг
+    void SetIdleTickPeriod(std::chrono::milliseconds period);
+    // listener вызывается после каждой публикации снимков: в конце тика и после команды без таймера.
+    // Вызов идёт в потоке тика, поэтому listener должен только передать оповещение дальше
+    void SetPublishListener(std::function<void()> listener);
+    // Статистика шагов моделирования, пустая без заданного шага
+    SimulationClock::Stats GetTickStats() const;
     model::Game& GetGameObj();
 
     const bool IsTick() const;
@@ -134,9 +170,99 @@ private:
     bool is_random_;
     bool is_tick_;
     UseCases& use_cases_;
+    // Пул для параллельного обновления сессий, без него сессии обновляются по очереди
+    std::shared_ptr<WorkerPool> tick_workers_;
+    std::optional<SimulationClock> clock_;
+    std::optional<int> idle_tick_period_;
+    std::function<void()> publish_listener_;
 
-    void CalcNewPos(std::shared_ptr<model::Dog> dog, model::Map::Roads& roads, std::vector<collision_detector::Gatherer>& gatherers, const int delta) const;
-    void CheckPlayerDisconnect(std::shared_ptr<model::Dog> dog, const int delta) const;
+    // Команда движения, ожидающая применения
+    struct MoveAction {
+        std::shared_ptr<Player> player;
+        model::Direction direction;
+        // Порядковый номер среди забранных из очереди команд
+        size_t sequence = 0;
+    };
+    util::MpscQueue<MoveAction> actions_;
+    // Буфер применения команд
+    std::vector<MoveAction> drained_actions_;
+
+    // Наибольшее число шагов моделирования за один тик
+    static constexpr unsigned MAX_STEPS_PER_TICK = 5;
+
+    // Собаки сессии делятся на полосы, только если в каждую попадёт не меньше MIN_DOGS_PER_REGION собак
+    static constexpr size_t MIN_DOGS_PER_REGION = 256;
+    static constexpr size_t REGIONS_PER_THREAD  = 4;
+
+    // Буферы полосы сессии
+    struct RegionBuffers {
+        std::vector<collision_detector::GatheringEvent> loot_events;
+        std::vector<collision_detector::GatheringEvent> office_events;
+        collision_detector::GatherScratch scratch;
+    };
+
+    // Буферы игрового цикла сессии, переиспользуются между тиками
+    struct TickBuffers {
+        std::vector<collision_detector::Gatherer> gatherers;
+        std::vector<collision_detector::Item> items;
+        collision_detector::ItemIndex loot_index;
+        // События всех полос, упорядоченные по времени
+        std::vector<collision_detector::GatheringEvent> loot_events;
+        std::vector<collision_detector::GatheringEvent> office_events;
+        std::vector<RegionBuffers> regions;
+        TickArena arena;
+    };
+    // tick_buffers_[i] принадлежат сессии game_.GetSessions()[i]
+    mutable std::vector<TickBuffers> tick_buffers_;
+    // Порядок обновления сессий пулом
+    mutable std::vector<size_t> tick_order_;
+    // Буферы для моделирования отложенного времени вне тика
+    mutable TickBuffers wake_buffers_;
+
+    // Тела ответов сессии на запросы чтения. /players меняется только с составом собак
+    struct SessionBodies {
+        VersionedBody state;
+        VersionedBody state_binary;
+        VersionedBody players;
+        // Полное состояние и изменения за последний тик для запросов с номером снимка
+        VersionedBody full_state;
+        VersionedBody last_delta;
+    };
+    // Сессии не удаляются, поэтому указатели на них остаются действительными
+    std::shared_mutex bodies_mutex_;
+    std::unordered_map<const model::GameSession*, std::unique_ptr<SessionBodies>> session_bodies_;
+
+    SessionBodies& GetSessionBodies(const model::GameSession& session);
+    static json::object BuildPlayers(const model::SessionSnapshot& snapshot);
+    static json::object BuildState(const model::SessionSnapshot& snapshot);
+    static json::object BuildDelta(const model::SessionSnapshot& base, const model::SessionSnapshot& current);
+    static json::object DogToJson(const model::SessionSnapshot::DogInfo& dog);
+    static json::object LootToJson(const model::LostObjects::Object& loot);
+
+    // Применяет накопленные команды движения, выполняется в strand
+    void ApplyActions();
+    // Публикует снимки изменившихся сессий в конце тика и оповещает подписчиков, если опубликован хотя бы один
+    void PublishSnapshots() const;
+    // Один шаг моделирования всех сессий
+    void Step(const int delta) const;
+    // Обновляет сессию с учётом адаптивной частоты
+    void UpdateSession(model::GameSession& session, TickBuffers& buffers, const int delta) const;
+    // Обрабатывает события событийной сессии за delta миллисекунд
+    void AdvanceSession(model::GameSession& session, const int delta) const;
+    // Моделирует отложенное время сессии перед действием игрока или подключением нового
+    void WakeSession(model::GameSession& session) const;
+    void TickSession(model::GameSession& session, TickBuffers& buffers, const int delta) const;
+    size_t RegionsCount(const model::GameSession& session) const;
+    // События полос с номерами собирателей сессии. Для единственной полосы возвращает её события без копирования.
+    // События одного момента упорядочиваются по id собак и номерам предметов, поэтому порядок их обработки
+    // не зависит от раскладки собак по индексам и полосам
+    const std::vector<collision_detector::GatheringEvent>& MergeRegionEvents(
+        TickBuffers& buffers, std::span<const size_t> offsets, std::span<const std::shared_ptr<model::Dog>> dogs,
+        std::vector<collision_detector::GatheringEvent> RegionBuffers::*events,
+        std::vector<collision_detector::GatheringEvent>& merged) const;
+    void CalcNewPos(model::GameSession& session, std::span<collision_detector::Gatherer> gatherers,
+                    const int delta, size_t begin, size_t end) const;
+    void CheckPlayerDisconnect(const std::shared_ptr<model::GameSession>& session) const;
 };
 
 }   // namespace app
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "alias_table.h"
+
+#include <numeric>
+
+namespace util {
+
+AliasTable::AliasTable(std::span<const double> weights)
+    : probability_(weights.size(), 1.0)
+    , alias_(weights.size()) {
+    const size_t count = weights.size();
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    if (count == 0 || total <= 0.0) {
+        std::iota(alias_.begin(), alias_.end(), size_t{0});
+        return;
+    }
+
+    // Веса, нормированные так, что средний столбец равен 1
+    std::vector<double> scaled(count);
+    std::vector<size_t> small;
+    std::vector<size_t> large;
+    for (size_t i = 0; i < count; ++i) {
+        scaled[i] = weights[i] * count / total;
+        (scaled[i] < 1.0 ? small : large).emplace_back(i);
+    }
+
+    // Недостающую до 1 часть малого столбца заполняет большой
+    while (!small.empty() && !large.empty()) {
+        const size_t less = small.back();
+        const size_t more = large.back();
+        small.pop_back();
+        probability_[less] = scaled[less];
+        alias_[less] = more;
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.emplace_back(more);
+        }
+    }
+
+    // Оставшиеся столбцы заполнены целиком, отличие от 1 - ошибка округления
+    for (size_t i : small) {
+        probability_[i] = 1.0;
+        alias_[i] = i;
+    }
+    for (size_t i : large) {
+        probability_[i] = 1.0;
+        alias_[i] = i;
+    }
+}
+
+}  // namespace util
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Таблица псевдонимов (метод Уолкера-Воуза) для выбора индекса с вероятностью,
+ *  пропорциональной его весу. Строится за O(n), а выбор занимает O(1) и не выделяет память:
+ *  берётся случайный столбец и по одному случайному числу решается, вернуть ли его или его псевдоним.
+ */
+class AliasTable {
+public:
+    AliasTable() = default;
+    // Веса неотрицательны. Если все они нулевые, индексы выбираются равновероятно
+    explicit AliasTable(std::span<const double> weights);
+
+    size_t Size() const noexcept {
+        return probability_.size();
+    }
+
+    bool Empty() const noexcept {
+        return probability_.empty();
+    }
+
+    // random - генератор с методами NextBelow(n) и NextDouble(), как у util::RandomEngine.
+    // Таблица не должна быть пустой
+    template <typename Random>
+    size_t Sample(Random& random) const {
+        const size_t column = static_cast<size_t>(random.NextBelow(probability_.size()));
+        return random.NextDouble() < probability_[column] ? column : alias_[column];
+    }
+
+private:
+    // Вероятность остаться в столбце и индекс, на который столбец уступает остаток
+    std::vector<double> probability_;
+    std::vector<size_t> alias_;
+};
+
+}  // namespace util
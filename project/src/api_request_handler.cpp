@@ -1,6 +1,11 @@
 #include "api_request_handler.h"
+#include "state_encoding.h"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <iostream>
+#include <optional>
 namespace http_handler {
 
     std::string_view maps_target    = "/api/v1/maps"sv;
@@ -24,9 +29,8 @@ namespace http_handler {
     // Получить список карт
     json::array getArrayMaps(auto& maps) {
         json::array arr_maps;
-        for(auto it = maps.begin(); it < maps.end(); it++) {
-            auto map = *it;
-            auto value = json::parse(map.GetConfig());
+        for(const auto& map : maps) {
+            auto value = json::parse(map->GetConfig());
             json::object obj ( {
                                 {"id",   getMapId(value)},
                                 {"name", getMapName(value)}
@@ -37,23 +41,164 @@ namespace http_handler {
         return std::move(arr_maps);
     }
 
-    StringResponse ApiRequestHandler::operator()(const StringRequest& req) {
+    ApiResponse ApiRequestHandler::operator()(const StringRequest& req) {
             return HandleRequest(req);
         }
 
-    StringResponse ApiRequestHandler::MakeStringResponse(http::status status, std::string_view body, unsigned http_version,
-                                                         bool keep_alive,
-                                                         std::string_view content_type = ContentType::TEXT_HTML) {
-        StringResponse response(status, http_version);
+    std::string_view TargetPath(std::string_view target) {
+        return target.substr(0, target.find('?'));
+    }
+
+    std::optional<std::string_view> QueryParam(std::string_view target, std::string_view name) {
+        const auto query_pos = target.find('?');
+        if(query_pos == target.npos) {
+            return std::nullopt;
+        }
+        std::string_view query = target.substr(query_pos + 1);
+        while(!query.empty()) {
+            const auto param = query.substr(0, query.find('&'));
+            if(param.size() > name.size() && param.substr(0, name.size()) == name && param[name.size()] == '=') {
+                return param.substr(name.size() + 1);
+            }
+            query.remove_prefix(std::min(query.size(), param.size() + 1));
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::uint64_t> ParseTick(std::string_view value) {
+        std::uint64_t tick = 0;
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), tick);
+        if(ec != std::errc{} || end != value.data() + value.size()) {
+            return std::nullopt;
+        }
+        return tick;
+    }
+
+    // Пробелы и табуляции по краям элемента заголовка
+    std::string_view TrimHeaderValue(std::string_view value) {
+        const auto begin = value.find_first_not_of(" \t");
+        if(begin == value.npos) {
+            return {};
+        }
+        return value.substr(begin, value.find_last_not_of(" \t") - begin + 1);
+    }
+
+    bool EqualsIgnoreCase(std::string_view l, std::string_view r) {
+        return std::equal(l.begin(), l.end(), r.begin(), r.end(), [](char l_char, char r_char) {
+            return std::tolower(static_cast<unsigned char>(l_char)) == std::tolower(static_cast<unsigned char>(r_char));
+        });
+    }
+
+    double AcceptQuality(std::string_view accept, std::string_view media_type) {
+        const std::string_view type = media_type.substr(0, media_type.find('/'));
+        // 0 - нет подходящего диапазона, 1 - */*, 2 - type/*, 3 - точное совпадение
+        int best_specificity = 0;
+        double quality = 0.0;
+        while(!accept.empty()) {
+            const auto comma = accept.find(',');
+            std::string_view range = accept.substr(0, comma);
+            accept.remove_prefix(comma == accept.npos ? accept.size() : comma + 1);
+
+            const auto semicolon = range.find(';');
+            const std::string_view range_type = TrimHeaderValue(range.substr(0, semicolon));
+            int specificity = 0;
+            if(EqualsIgnoreCase(range_type, media_type)) {
+                specificity = 3;
+            } else if(range_type.size() == type.size() + 2 && EqualsIgnoreCase(range_type.substr(0, type.size()), type) &&
+                      range_type.substr(type.size()) == "/*"sv) {
+                specificity = 2;
+            } else if(range_type == "*/*"sv) {
+                specificity = 1;
+            }
+            if(specificity <= best_specificity) {
+                continue;
+            }
+
+            double range_quality = 1.0;
+            std::string_view params = semicolon == range.npos ? std::string_view{} : range.substr(semicolon + 1);
+            while(!params.empty()) {
+                const auto next = params.find(';');
+                const std::string_view param = TrimHeaderValue(params.substr(0, next));
+                params.remove_prefix(next == params.npos ? params.size() : next + 1);
+                if(param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                    double value = 0.0;
+                    const auto [end, ec] = std::from_chars(param.data() + 2, param.data() + param.size(), value);
+                    if(ec == std::errc{} && end == param.data() + param.size() && value >= 0.0 && value <= 1.0) {
+                        range_quality = value;
+                    }
+                }
+            }
+            best_specificity = specificity;
+            quality = range_quality;
+        }
+        return quality;
+    }
+
+    std::optional<std::string_view> BearerToken(const StringRequest& req) {
+        auto it = req.find(http::field::authorization);
+        if(it == req.end()) {
+            return std::nullopt;
+        }
+        std::string_view authorizationValue = it->value();
+        if(authorizationValue.npos == authorizationValue.find("Bearer") ||
+           authorizationValue.size() != (TOKEN_LENGTH + 7)) { // 7 - длина слова Bearer + пробел
+            return std::nullopt;
+        }
+        return authorizationValue.substr(7); // 7 - длина слова Bearer + пробел
+    }
+
+    std::optional<ApiRequestHandler::StateWait> ApiRequestHandler::ParseStateWait(const StringRequest& req) const {
+        if(TargetPath(req.target()) != state_target ||
+           (req.method() != http::verb::get && req.method() != http::verb::head)) {
+            return std::nullopt;
+        }
+        const auto after = QueryParam(req.target(), "after"sv);
+        const auto tick  = after ? ParseTick(*after) : std::nullopt;
+        const auto token = BearerToken(req);
+        if(!tick || !token) {
+            return std::nullopt;
+        }
+        return StateWait{std::string {*token}, *tick};
+    }
+
+    ApiResponse ApiRequestHandler::MakeStateResponse(const StringRequest& req, const app::ResponseBody& body,
+                                                     std::string_view content_type) {
+        if(!body) {
+            const auto obj = json::object {{"code", "unknownToken"}, {"message", "Player token has not been found"}};
+            return MakeStringResponse(http::status::unauthorized, json::serialize(obj), req.version(), req.keep_alive(),
+                                      ContentType::JSON);
+        }
+        return MakeSharedResponse(http::status::ok, body, req.version(), req.keep_alive(), content_type);
+    }
+
+    bool ApiRequestHandler::NeedsStrand(std::string_view target) const {
+        target = TargetPath(target);
+        if(target == state_target || target == players_target) {
+            return false;
+        }
+        return target != action_target || !app_.IsTick();
+    }
+
+    ApiResponse ApiRequestHandler::MakeStringResponse(http::status status, std::string_view body, unsigned http_version,
+                                                      bool keep_alive,
+                                                      std::string_view content_type = ContentType::TEXT_HTML) {
+        return MakeSharedResponse(status, std::make_shared<const std::string>(body), http_version, keep_alive,
+                                  content_type);
+    }
+
+    ApiResponse ApiRequestHandler::MakeSharedResponse(http::status status, app::ResponseBody body,
+                                                      unsigned http_version, bool keep_alive,
+                                                      std::string_view content_type) {
+        ApiResponse response(status, http_version);
         response.set(http::field::content_type, content_type);
-        response.body() = body;
-        response.content_length(body.size());
+        response.content_length(body->size());
+        response.body() = std::move(body);
         response.keep_alive(keep_alive);
         response.set(http::field::cache_control, "no-cache");
         return response;
     }
 
-    StringResponse ApiRequestHandler::HandleRequest(const StringRequest& req) {
+    ApiResponse ApiRequestHandler::HandleRequest(const StringRequest& req) {
         const auto text_response = [&req, this](http::status status, std::string_view text) {
             return MakeStringResponse(status, text, req.version(), req.keep_alive(), ContentType::JSON);
         };
@@ -131,29 +276,20 @@ namespace http_handler {
                 response.set(http::field::allow, "GET, HEAD");
                 return response;
             }
-            std::string_view authorizationValue;
-            try {
-                authorizationValue = req.at(http::field::authorization);
-                if(authorizationValue.npos == authorizationValue.find("Bearer") ||
-                   authorizationValue.size() != (32 + 7)) { // 32 - длина токена + 7 - длина слова Bearer + пробел
-                    throw std::invalid_argument("Invalid token");
-                }
-            } catch (const boost::wrapexcept<std::out_of_range>& e) {
-                const auto obj = createErrorResponse("invalidToken", "Invalid token");
-                return text_response(http::status::unauthorized, json::serialize(obj));
-            } catch (const std::invalid_argument& e) {
+            const auto token = BearerToken(req);
+            if(!token) {
                 const auto obj = createErrorResponse("invalidToken", "Invalid token");
                 return text_response(http::status::unauthorized, json::serialize(obj));
             }
-            std::string_view token = authorizationValue.substr(7); // 7 - длина слова Bearer + пробел
-            json::object obj = app_.GetPlayers(std::string {token});
-            auto status = http::status::ok;
-            if(auto it = obj.find("code"); it != obj.end() && obj["code"] == "unknownToken") {
-                status = http::status::unauthorized;
+            auto body = app_.GetPlayers(std::string {*token});
+            if(!body) {
+                const auto obj = createErrorResponse("unknownToken", "Player token has not been found");
+                return text_response(http::status::unauthorized, json::serialize(obj));
             }
-            return text_response(status, json::serialize(obj));
+            return MakeSharedResponse(http::status::ok, std::move(body), req.version(), req.keep_alive(),
+                                      ContentType::JSON);
         }
-        if(req.target() == state_target) {
+        if(TargetPath(req.target()) == state_target) {
             if(req.method() != http::verb::get &&
                req.method() != http::verb::head) {
                 const auto obj = createErrorResponse("invalidMethod", "Only POST method is expected");
@@ -161,27 +297,40 @@ namespace http_handler {
                 response.set(http::field::allow, "GET, HEAD");
                 return response;
             }
-            std::string_view authorizationValue;
-            try {
-                authorizationValue = req.at(http::field::authorization);
-                if(authorizationValue.npos == authorizationValue.find("Bearer") ||
-                   authorizationValue.size() != (32 + 7)) { // 32 - длина токена + 7 - длина слова Bearer + пробел
-                    throw std::invalid_argument("Invalid token");
-                }
-            } catch (const boost::wrapexcept<std::out_of_range>& e) {
-                const auto obj = createErrorResponse("invalidToken", "Invalid token");
-                return text_response(http::status::unauthorized, json::serialize(obj));
-            } catch (const std::invalid_argument& e) {
+            const auto token = BearerToken(req);
+            if(!token) {
                 const auto obj = createErrorResponse("invalidToken", "Invalid token");
                 return text_response(http::status::unauthorized, json::serialize(obj));
             }
-            std::string_view token = authorizationValue.substr(7); // 7 - длина слова Bearer + пробел
-            json::object obj = app_.GetState(std::string {token});
-            auto status = http::status::ok;
-            if(auto it = obj.find("code"); it != obj.end() && obj["code"] == "unknownToken") {
-                status = http::status::unauthorized;
+            // С параметром since отдаются только изменения после снимка с этим номером.
+            // Ожидание по параметру after выполняет RequestHandler, здесь такой запрос отвечает сразу
+            auto since_param = QueryParam(req.target(), "since"sv);
+            if(!since_param) {
+                since_param = QueryParam(req.target(), "after"sv);
             }
-            return text_response(status, json::serialize(obj));
+            std::optional<std::uint64_t> since;
+            if(since_param) {
+                since = ParseTick(*since_param);
+                if(!since) {
+                    const auto obj = createErrorResponse("invalidArgument", "Invalid tick");
+                    return text_response(http::status::bad_request, json::serialize(obj));
+                }
+            }
+            if(since) {
+                return MakeStateResponse(req, app_.GetStateSince(std::string {*token}, *since).body);
+            }
+            // Двоичное представление отдаётся клиенту, который явно принимает его не хуже JSON
+            bool binary = false;
+            if(auto it = req.find(http::field::accept); it != req.end()) {
+                const double binary_quality = AcceptQuality(it->value(), app::STATE_BINARY_CONTENT_TYPE);
+                binary = binary_quality > 0.0 && binary_quality >= AcceptQuality(it->value(), ContentType::JSON);
+            }
+            auto response = binary
+                ? MakeStateResponse(req, app_.GetStateBinary(std::string {*token}), app::STATE_BINARY_CONTENT_TYPE)
+                : MakeStateResponse(req, app_.GetState(std::string {*token}));
+            // Представление зависит от заголовка Accept, кэши должны учитывать его
+            response.set(http::field::vary, "Accept");
+            return response;
         }
         if(req.target() == action_target) {
             if(req.method() != http::verb::post) {
@@ -190,21 +339,11 @@ namespace http_handler {
                 response.set(http::field::allow, "POST");
                 return response;
             }
-            std::string_view authorizationValue;
-            try {
-                authorizationValue = req.at(http::field::authorization);
-                if(authorizationValue.npos == authorizationValue.find("Bearer") ||
-                   authorizationValue.size() != (32 + 7)) { // 32 - длина токена + 7 - длина слова Bearer + пробел
-                    throw std::invalid_argument("Invalid token");
-                }
-            } catch (const boost::wrapexcept<std::out_of_range>& e) {
-                const auto obj = createErrorResponse("invalidToken", "Invalid token");
-                return text_response(http::status::unauthorized, json::serialize(obj));
-            } catch (const std::invalid_argument& e) {
+            const auto token = BearerToken(req);
+            if(!token) {
                 const auto obj = createErrorResponse("invalidToken", "Invalid token");
                 return text_response(http::status::unauthorized, json::serialize(obj));
             }
-            std::string_view token = authorizationValue.substr(7); // 7 - длина слова Bearer + пробел
             std::string body = req.body();
             json::value json = json::parse(body);
             std::string_view dir;
@@ -221,7 +360,7 @@ namespace http_handler {
                 const auto obj = createErrorResponse("invalidArgument", "Invalid content type");
                 return text_response(http::status::bad_request, json::serialize(obj));
             }
-            json::object obj = app_.Move(std::string {token}, dir);
+            json::object obj = app_.Move(std::string {*token}, dir);
             auto status = http::status::ok;
             if(auto it = obj.find("code"); it != obj.end() && obj["code"] == "unknownToken") {
                 status = http::status::unauthorized;
@@ -1,8 +1,10 @@
 #pragma once
 #include "http_server.h"
 #include <boost/json.hpp>
+#include <optional>
 #include "model.h"
 #include "Players.h"
+#include "shared_body.h"
 
 namespace http_handler {
     namespace beast = boost::beast;
@@ -11,16 +13,47 @@ namespace http_handler {
     namespace json  = boost::json;
     namespace fs    = std::filesystem;
 
-    using StringResponse = http::response<http::string_body>;
-    using StringRequest  = http::request<http::string_body>;
+    // Ответ REST API. Тело разделяется с кэшем ответов, поэтому готовые тела отправляются без копирования
+    using ApiResponse   = http::response<SharedStringBody>;
+    using StringRequest = http::request<http::string_body>;
     using namespace std::literals;
 
+    // Путь запроса без параметров
+    std::string_view TargetPath(std::string_view target);
+    // Значение параметра name строки запроса
+    std::optional<std::string_view> QueryParam(std::string_view target, std::string_view name);
+    // Номер снимка из параметра запроса
+    std::optional<std::uint64_t> ParseTick(std::string_view value);
+    // Вес типа содержимого media_type в заголовке Accept по самому конкретному подходящему диапазону,
+    // 0 - тип не принимается
+    double AcceptQuality(std::string_view accept, std::string_view media_type);
+    // Длина токена игрока
+    constexpr size_t TOKEN_LENGTH = 32;
+    // Токен игрока из заголовка Authorization вида "Bearer <токен>", nullopt при отсутствии заголовка или неверном формате
+    std::optional<std::string_view> BearerToken(const StringRequest& req);
+
     class ApiRequestHandler {
     public:
         explicit ApiRequestHandler(app::Application& app) 
             : app_{app} {}
 
-        StringResponse operator()(const StringRequest& req);
+        ApiResponse operator()(const StringRequest& req);
+
+        // Требует ли запрос выполнения в strand. Состояние читается из снимков сессий,
+        // а команды движения при работе по таймеру только ставятся в очередь Application,
+        // поэтому такие запросы обрабатываются в потоке запроса
+        bool NeedsStrand(std::string_view target) const;
+
+        // Запрос /state?after=<tick>, ответ на который ждёт публикации снимка новее tick
+        struct StateWait {
+            std::string token;
+            std::uint64_t after = 0;
+        };
+        // Возвращает nullopt для остальных запросов и для запросов с ошибками, их обрабатывает operator()
+        std::optional<StateWait> ParseStateWait(const StringRequest& req) const;
+        // Ответ на запрос состояния по телу из Application, nullptr означает неизвестный токен
+        ApiResponse MakeStateResponse(const StringRequest& req, const app::ResponseBody& body,
+                                      std::string_view content_type = ContentType::JSON);
 
     private:
 
@@ -34,11 +67,15 @@ namespace http_handler {
             constexpr static std::string_view JSON      = "application/json"sv;
         };
 
-        // Создаёт StringResponse с заданными параметрами
-        StringResponse MakeStringResponse(http::status status, std::string_view body, unsigned http_version,
-                                        bool keep_alive,
-                                        std::string_view content_type);
+        // Создаёт ApiResponse с копией тела body
+        ApiResponse MakeStringResponse(http::status status, std::string_view body, unsigned http_version,
+                                       bool keep_alive,
+                                       std::string_view content_type);
+        // Создаёт ApiResponse, который отправляет готовое тело body без копирования
+        ApiResponse MakeSharedResponse(http::status status, app::ResponseBody body, unsigned http_version,
+                                       bool keep_alive,
+                                       std::string_view content_type);
 
-        StringResponse HandleRequest(const StringRequest& req);
+        ApiResponse HandleRequest(const StringRequest& req);
     };
 }
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "collision_detector.h"
 #include <cassert>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 namespace collision_detector {
 
@@ -22,40 +27,302 @@ CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D
     return CollectionResult(sq_distance, proj_ratio);
 }
 
-std::vector<GatheringEvent> FindGatherEvents(
-    const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> detected_events;
+namespace {
 
-    static auto eq_pt = [](geom::Point2D p1, geom::Point2D p2) {
-        return p1.x == p2.x && p1.y == p2.y;
-    };
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLLISION_DETECTOR_X86_KERNELS 1
 
-    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
-        Gatherer gatherer = provider.GetGatherer(g);
-        if (eq_pt(gatherer.start_pos, gatherer.end_pos)) {
-            continue;
+// Векторные ядра повторяют вычисления TryCollectPoint для нескольких точек сразу.
+// Каждое обрабатывает целые блоки начиная с i и возвращает номер первой необработанной точки
+
+// AVX собирается для своей функции отдельно, сборка проекта не требует -mavx
+__attribute__((target("avx")))
+size_t CollectPointsAvx(geom::Point2D a, double v_x, double v_y, double v_len2, double gatherer_width,
+                        std::span<const double> xs, std::span<const double> ys, std::span<const double> widths,
+                        size_t i, std::vector<CollectedPoint>& collected) {
+    const size_t count = xs.size();
+    const __m256d ax = _mm256_set1_pd(a.x);
+    const __m256d ay = _mm256_set1_pd(a.y);
+    const __m256d vx = _mm256_set1_pd(v_x);
+    const __m256d vy = _mm256_set1_pd(v_y);
+    const __m256d vlen2 = _mm256_set1_pd(v_len2);
+    const __m256d gw = _mm256_set1_pd(gatherer_width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    for (; i + 4 <= count; i += 4) {
+        const __m256d ux = _mm256_sub_pd(_mm256_loadu_pd(xs.data() + i), ax);
+        const __m256d uy = _mm256_sub_pd(_mm256_loadu_pd(ys.data() + i), ay);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(ux, vx), _mm256_mul_pd(uy, vy));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(ux, ux), _mm256_mul_pd(uy, uy));
+        const __m256d proj = _mm256_div_pd(u_dot_v, vlen2);
+        const __m256d sq_dist = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), vlen2));
+        const __m256d radius = _mm256_add_pd(gw, _mm256_loadu_pd(widths.data() + i));
+        const __m256d hit = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_dist, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+        int mask = _mm256_movemask_pd(hit);
+        if (mask != 0) {
+            alignas(32) double proj_lanes[4];
+            alignas(32) double dist_lanes[4];
+            _mm256_store_pd(proj_lanes, proj);
+            _mm256_store_pd(dist_lanes, sq_dist);
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    collected.push_back({i + lane, CollectionResult{dist_lanes[lane], proj_lanes[lane]}});
+                }
+            }
         }
-        for (size_t i = 0; i < provider.ItemsCount(); ++i) {
-            Item item = provider.GetItem(i);
-            auto collect_result
-                = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
-
-            if (collect_result.IsCollected(gatherer.width + item.width)) {
-                GatheringEvent evt{.item_id = i,
-                                   .gatherer_id = g,
-                                   .sq_distance = collect_result.sq_distance,
-                                   .time = collect_result.proj_ratio};
-                detected_events.push_back(evt);
+    }
+    return i;
+}
+
+// SSE2 есть на любом x86-64, поэтому ядро тоже собирается для своей функции явно
+__attribute__((target("sse2")))
+size_t CollectPointsSse2(geom::Point2D a, double v_x, double v_y, double v_len2, double gatherer_width,
+                         std::span<const double> xs, std::span<const double> ys, std::span<const double> widths,
+                         size_t i, std::vector<CollectedPoint>& collected) {
+    const size_t count = xs.size();
+    const __m128d ax = _mm_set1_pd(a.x);
+    const __m128d ay = _mm_set1_pd(a.y);
+    const __m128d vx = _mm_set1_pd(v_x);
+    const __m128d vy = _mm_set1_pd(v_y);
+    const __m128d vlen2 = _mm_set1_pd(v_len2);
+    const __m128d gw = _mm_set1_pd(gatherer_width);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    for (; i + 2 <= count; i += 2) {
+        const __m128d ux = _mm_sub_pd(_mm_loadu_pd(xs.data() + i), ax);
+        const __m128d uy = _mm_sub_pd(_mm_loadu_pd(ys.data() + i), ay);
+        const __m128d u_dot_v = _mm_add_pd(_mm_mul_pd(ux, vx), _mm_mul_pd(uy, vy));
+        const __m128d u_len2 = _mm_add_pd(_mm_mul_pd(ux, ux), _mm_mul_pd(uy, uy));
+        const __m128d proj = _mm_div_pd(u_dot_v, vlen2);
+        const __m128d sq_dist = _mm_sub_pd(u_len2, _mm_div_pd(_mm_mul_pd(u_dot_v, u_dot_v), vlen2));
+        const __m128d radius = _mm_add_pd(gw, _mm_loadu_pd(widths.data() + i));
+        const __m128d hit = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(proj, zero), _mm_cmple_pd(proj, one)),
+                                       _mm_cmple_pd(sq_dist, _mm_mul_pd(radius, radius)));
+        int mask = _mm_movemask_pd(hit);
+        if (mask != 0) {
+            alignas(16) double proj_lanes[2];
+            alignas(16) double dist_lanes[2];
+            _mm_store_pd(proj_lanes, proj);
+            _mm_store_pd(dist_lanes, sq_dist);
+            for (int lane = 0; lane < 2; ++lane) {
+                if (mask & (1 << lane)) {
+                    collected.push_back({i + lane, CollectionResult{dist_lanes[lane], proj_lanes[lane]}});
+                }
             }
         }
     }
+    return i;
+}
 
+// Поддержка AVX определяется один раз по процессору, на котором запущен сервер
+bool HasAvx() {
+    static const bool has_avx = __builtin_cpu_supports("avx");
+    return has_avx;
+}
+
+#endif
+
+}  // namespace
+
+void TryCollectPoints(geom::Point2D a, geom::Point2D b, double gatherer_width,
+                      std::span<const double> xs, std::span<const double> ys, std::span<const double> widths,
+                      std::vector<CollectedPoint>& collected) {
+    assert(b.x != a.x || b.y != a.y);
+    assert(xs.size() == ys.size() && xs.size() == widths.size());
+    const double v_x = b.x - a.x;
+    const double v_y = b.y - a.y;
+    const double v_len2 = v_x * v_x + v_y * v_y;
+    const size_t count = xs.size();
+    size_t i = 0;
+
+#if defined(COLLISION_DETECTOR_X86_KERNELS)
+    if (HasAvx()) {
+        i = CollectPointsAvx(a, v_x, v_y, v_len2, gatherer_width, xs, ys, widths, i, collected);
+    }
+    // Хвост короче четырёх точек ядро SSE2 тоже обрабатывает парами
+    i = CollectPointsSse2(a, v_x, v_y, v_len2, gatherer_width, xs, ys, widths, i, collected);
+#endif
+
+    // Остаток, а также вся работа на платформах без векторных инструкций
+    for (; i < count; ++i) {
+        const CollectionResult result = TryCollectPoint(a, b, geom::Point2D{xs[i], ys[i]});
+        if (result.IsCollected(gatherer_width + widths[i])) {
+            collected.push_back({i, result});
+        }
+    }
+}
+
+namespace {
+// Минимальный размер ячейки сетки предметов
+constexpr double MIN_CELL_SIZE = 1.0;
+// Ограничение на число ячеек по одной оси
+constexpr size_t MAX_CELLS_PER_AXIS = 1024;
+
+bool IsStaying(const Gatherer& gatherer) {
+    return gatherer.start_pos.x == gatherer.end_pos.x && gatherer.start_pos.y == gatherer.end_pos.y;
+}
+
+// Проверяет столкновения одного собирателя с предметами сетки рядом с его путём
+void CollectGathererEvents(const ItemIndex& items, const Gatherer& gatherer, size_t gatherer_id,
+                           std::vector<CollectedPoint>& collected,
+                           std::vector<GatheringEvent>& detected_events) {
+    const double radius = gatherer.width + items.MaxItemWidth();
+    const size_t first_event = detected_events.size();
+    items.ForEachCellNear(std::min(gatherer.start_pos.x, gatherer.end_pos.x) - radius,
+                          std::min(gatherer.start_pos.y, gatherer.end_pos.y) - radius,
+                          std::max(gatherer.start_pos.x, gatherer.end_pos.x) + radius,
+                          std::max(gatherer.start_pos.y, gatherer.end_pos.y) + radius,
+                          [&](const ItemsView& cell) {
+                              collected.clear();
+                              TryCollectPoints(gatherer.start_pos, gatherer.end_pos, gatherer.width,
+                                               cell.xs, cell.ys, cell.widths, collected);
+                              for (const auto& point : collected) {
+                                  GatheringEvent evt{.item_id = cell.ids[point.index],
+                                                     .gatherer_id = gatherer_id,
+                                                     .sq_distance = point.result.sq_distance,
+                                                     .time = point.result.proj_ratio};
+                                  detected_events.push_back(evt);
+                              }
+                          });
+    // События собирателя упорядочиваются по номерам предметов, как при полном переборе
+    std::sort(detected_events.begin() + first_event, detected_events.end(),
+              [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
+                  return e_l.item_id < e_r.item_id;
+              });
+}
+
+}  // namespace
+
+void SortGatherEvents(std::vector<GatheringEvent>& detected_events) {
     std::sort(detected_events.begin(), detected_events.end(),
               [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
                   return e_l.time < e_r.time;
               });
+}
+
+ItemIndex::ItemIndex(std::span<const Item> items) {
+    Rebuild(items);
+}
+
+void ItemIndex::Rebuild(std::span<const Item> items) {
+    items_count_ = items.size();
+    max_item_width_ = 0.0;
+    cols_ = 0;
+    rows_ = 0;
+    cell_offsets_.clear();
+    cell_item_ids_.clear();
+    cell_xs_.clear();
+    cell_ys_.clear();
+    cell_widths_.clear();
+    if (items.empty()) {
+        return;
+    }
+
+    double min_x = items.front().position.x;
+    double min_y = items.front().position.y;
+    double max_x = min_x;
+    double max_y = min_y;
+    for (const auto& item : items) {
+        min_x = std::min(min_x, item.position.x);
+        min_y = std::min(min_y, item.position.y);
+        max_x = std::max(max_x, item.position.x);
+        max_y = std::max(max_y, item.position.y);
+        max_item_width_ = std::max(max_item_width_, item.width);
+    }
+    const double width  = max_x - min_x;
+    const double height = max_y - min_y;
+
+    // В среднем один предмет на ячейку
+    cell_size_ = std::max(MIN_CELL_SIZE, std::sqrt(width * height / items.size()));
+    cell_size_ = std::max({cell_size_, width / MAX_CELLS_PER_AXIS, height / MAX_CELLS_PER_AXIS});
+    origin_x_ = min_x;
+    origin_y_ = min_y;
+    cols_ = static_cast<size_t>(width / cell_size_) + 1;
+    rows_ = static_cast<size_t>(height / cell_size_) + 1;
+
+    // Сортировка подсчётом: сначала размеры ячеек, затем раскладка предметов
+    cell_offsets_.assign(cols_ * rows_ + 1, 0);
+    for (const auto& item : items) {
+        ++cell_offsets_[RowOf(item.position.y) * cols_ + ColOf(item.position.x) + 1];
+    }
+    for (size_t cell = 1; cell < cell_offsets_.size(); ++cell) {
+        cell_offsets_[cell] += cell_offsets_[cell - 1];
+    }
+
+    cell_item_ids_.resize(items.size());
+    cell_xs_.resize(items.size());
+    cell_ys_.resize(items.size());
+    cell_widths_.resize(items.size());
+    cell_fill_.assign(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (size_t item_id = 0; item_id < items.size(); ++item_id) {
+        const Item& item = items[item_id];
+        const size_t pos = cell_fill_[RowOf(item.position.y) * cols_ + ColOf(item.position.x)]++;
+        cell_item_ids_[pos] = item_id;
+        cell_xs_[pos] = item.position.x;
+        cell_ys_[pos] = item.position.y;
+        cell_widths_[pos] = item.width;
+    }
+}
+
+size_t ItemIndex::ColOf(double x) const noexcept {
+    if (x <= origin_x_) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>((x - origin_x_) / cell_size_), cols_ - 1);
+}
+
+size_t ItemIndex::RowOf(double y) const noexcept {
+    if (y <= origin_y_) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>((y - origin_y_) / cell_size_), rows_ - 1);
+}
+
+void FindGatherEvents(std::span<const Item> items, std::span<const Gatherer> gatherers,
+                      std::vector<GatheringEvent>& events, GatherScratch& scratch) {
+    scratch.items.Rebuild(items);
+    FindGatherEvents(scratch.items, gatherers, events, scratch);
+}
+
+void FindGatherEvents(const ItemIndex& items, std::span<const Gatherer> gatherers,
+                      std::vector<GatheringEvent>& events, GatherScratch& scratch) {
+    events.clear();
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        if (IsStaying(gatherers[g])) {
+            continue;
+        }
+        CollectGathererEvents(items, gatherers[g], g, scratch.collected, events);
+    }
+
+    SortGatherEvents(events);
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    // Предметы и собиратели читаются из провайдера по одному разу
+    std::vector<Item> items;
+    items.reserve(provider.ItemsCount());
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        items.push_back(provider.GetItem(i));
+    }
+    std::vector<Gatherer> gatherers;
+    gatherers.reserve(provider.GatherersCount());
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        gatherers.push_back(provider.GetGatherer(g));
+    }
+
+    std::vector<GatheringEvent> events;
+    GatherScratch scratch;
+    FindGatherEvents(items, gatherers, events, scratch);
+    return events;
+}
 
-    return detected_events;
+std::vector<GatheringEvent> FindGatherEvents(const ItemIndex& items, std::span<const Gatherer> gatherers) {
+    std::vector<GatheringEvent> events;
+    GatherScratch scratch;
+    FindGatherEvents(items, gatherers, events, scratch);
+    return events;
 }
 
-}  // namespace collision_detector
\ No newline at end of file
+}  // namespace collision_detector
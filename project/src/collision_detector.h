@@ -3,6 +3,7 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <span>
 #include <vector>
 
 namespace collision_detector {
@@ -23,6 +24,19 @@ struct CollectionResult {
 // Эта функция реализована в уроке.
 CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c);
 
+struct CollectedPoint {
+    // номер точки во входных массивах
+    size_t index;
+    CollectionResult result;
+};
+
+// Пакетный вариант TryCollectPoint: движемся из a в b и пытаемся подобрать точки (xs[i], ys[i])
+// шириной widths[i] собирателем ширины gatherer_width. Подобранные точки добавляются в collected.
+// Точки обрабатываются по несколько за раз инструкциями AVX или SSE2, выбор делается по процессору при запуске.
+void TryCollectPoints(geom::Point2D a, geom::Point2D b, double gatherer_width,
+                      std::span<const double> xs, std::span<const double> ys, std::span<const double> widths,
+                      std::vector<CollectedPoint>& collected);
+
 struct Item {
     geom::Point2D position;
     double width;
@@ -52,6 +66,105 @@ struct GatheringEvent {
     double time;
 };
 
+// Предметы в виде параллельных массивов
+struct ItemsView {
+    std::span<const size_t> ids;
+    std::span<const double> xs;
+    std::span<const double> ys;
+    std::span<const double> widths;
+};
+
+/*
+ *  Равномерная сетка предметов для грубой фазы поиска столкновений.
+ *  Предмет попадает в ячейку, содержащую его центр, а запрос расширяется
+ *  на наибольшую ширину предмета, поэтому проверяются только предметы рядом с путём собирателя.
+ *  Предметы каждой ячейки лежат подряд в параллельных массивах.
+ */
+class ItemIndex {
+public:
+    ItemIndex() = default;
+    explicit ItemIndex(std::span<const Item> items);
+
+    // Перестраивает сетку для новых предметов, переиспользуя выделенную память
+    void Rebuild(std::span<const Item> items);
+
+    size_t ItemsCount() const noexcept {
+        return items_count_;
+    }
+
+    double MaxItemWidth() const noexcept {
+        return max_item_width_;
+    }
+
+    // Вызывает fn(ItemsView) для непустых ячеек, которые пересекает прямоугольник
+    template <typename Fn>
+    void ForEachCellNear(double min_x, double min_y, double max_x, double max_y, Fn&& fn) const {
+        if (items_count_ == 0 || max_x < origin_x_ || max_y < origin_y_) {
+            return;
+        }
+        const size_t col_begin = ColOf(min_x);
+        const size_t col_end   = ColOf(max_x);
+        const size_t row_begin = RowOf(min_y);
+        const size_t row_end   = RowOf(max_y);
+        for (size_t row = row_begin; row <= row_end; ++row) {
+            for (size_t col = col_begin; col <= col_end; ++col) {
+                const size_t cell  = row * cols_ + col;
+                const size_t begin = cell_offsets_[cell];
+                const size_t count = cell_offsets_[cell + 1] - begin;
+                if (count != 0) {
+                    fn(ItemsView{{cell_item_ids_.data() + begin, count},
+                                 {cell_xs_.data() + begin, count},
+                                 {cell_ys_.data() + begin, count},
+                                 {cell_widths_.data() + begin, count}});
+                }
+            }
+        }
+    }
+
+private:
+    size_t ColOf(double x) const noexcept;
+    size_t RowOf(double y) const noexcept;
+
+    size_t items_count_ = 0;
+    double max_item_width_ = 0.0;
+
+    double origin_x_ = 0.0;
+    double origin_y_ = 0.0;
+    double cell_size_ = 1.0;
+    size_t cols_ = 0;
+    size_t rows_ = 0;
+
+    // Предметы ячейки cell занимают элементы [cell_offsets_[cell], cell_offsets_[cell + 1]) массивов
+    std::vector<size_t> cell_offsets_;
+    std::vector<size_t> cell_item_ids_;
+    std::vector<double> cell_xs_;
+    std::vector<double> cell_ys_;
+    std::vector<double> cell_widths_;
+    // Позиции заполнения ячеек при построении
+    std::vector<size_t> cell_fill_;
+};
+
+// Буферы поиска событий, которые вызывающий переиспользует между вызовами
+struct GatherScratch {
+    ItemIndex items;
+    std::vector<CollectedPoint> collected;
+};
+
+// Поиск событий для непрерывных массивов предметов и собирателей.
+// События записываются в events (прежнее содержимое удаляется), память берётся из scratch,
+// поэтому повторные вызовы с теми же буферами почти не выделяют память.
+void FindGatherEvents(std::span<const Item> items, std::span<const Gatherer> gatherers,
+                      std::vector<GatheringEvent>& events, GatherScratch& scratch);
+
+// То же для заранее проиндексированных предметов, например неподвижных офисов карты
+void FindGatherEvents(const ItemIndex& items, std::span<const Gatherer> gatherers,
+                      std::vector<GatheringEvent>& events, GatherScratch& scratch);
+
+// Упорядочивает события по времени, например после объединения результатов нескольких вызовов
+void SortGatherEvents(std::vector<GatheringEvent>& events);
+
+// Обёртки, возвращающие события в новом векторе
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+std::vector<GatheringEvent> FindGatherEvents(const ItemIndex& items, std::span<const Gatherer> gatherers);
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "dog_states.h"
+
+#include <algorithm>
+
+namespace model {
+using namespace std::literals;
+
+namespace {
+constexpr double MILLISECONDS_IN_SECOND = 1000.0;
+
+template <typename T>
+void RemoveSwap(std::vector<T>& values, size_t slot) {
+    values[slot] = values.back();
+    values.pop_back();
+}
+
+// Переставляет элементы на месте по циклам перестановки order, заданным их началами
+template <typename T>
+void Permute(std::vector<T>& values, std::span<const size_t> order, std::span<const size_t> cycle_starts) {
+    for(size_t start : cycle_starts) {
+        T first = values[start];
+        size_t slot = start;
+        for(; order[slot] != start; slot = order[slot]) {
+            values[slot] = values[order[slot]];
+        }
+        values[slot] = first;
+    }
+}
+}  // namespace
+
+std::optional<Direction> ParseDirection(std::string_view dir) noexcept {
+    if(dir == "U"sv) {
+        return Direction::UP;
+    } else if(dir == "D"sv) {
+        return Direction::DOWN;
+    } else if(dir == "L"sv) {
+        return Direction::LEFT;
+    } else if(dir == "R"sv) {
+        return Direction::RIGHT;
+    } else if(dir == ""sv) {
+        return Direction::NONE;
+    }
+    return std::nullopt;
+}
+
+std::string_view DirectionToString(Direction dir) noexcept {
+    switch(dir) {
+        case Direction::UP:    return "U"sv;
+        case Direction::DOWN:  return "D"sv;
+        case Direction::LEFT:  return "L"sv;
+        case Direction::RIGHT: return "R"sv;
+        case Direction::NONE:  break;
+    }
+    return ""sv;
+}
+
+size_t DogStates::Size() const noexcept {
+    return x.size();
+}
+
+bool DogStates::IsIdle() const noexcept {
+    for(size_t i = 0; i < x.size(); ++i) {
+        if(speed_x[i] != 0.0 || speed_y[i] != 0.0 || is_move[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t DogStates::Add(double pos_x, double pos_y) {
+    x.emplace_back(pos_x);
+    y.emplace_back(pos_y);
+    prev_x.emplace_back(pos_x);
+    prev_y.emplace_back(pos_y);
+    speed_x.emplace_back(0.0);
+    speed_y.emplace_back(0.0);
+    dir.emplace_back(Direction::UP);
+    play_time.emplace_back(0.0);
+    stop_time.emplace_back(0.0);
+    is_move.emplace_back(0);
+    seg_time.emplace_back(0.0);
+    end_time.emplace_back(0.0);
+    end_x.emplace_back(pos_x);
+    end_y.emplace_back(pos_y);
+    join_time.emplace_back(0.0);
+    idle_since.emplace_back(0.0);
+    epoch.emplace_back(0);
+    next_x_.emplace_back(pos_x);
+    next_y_.emplace_back(pos_y);
+    return x.size() - 1;
+}
+
+void DogStates::Remove(size_t slot) {
+    RemoveSwap(x, slot);
+    RemoveSwap(y, slot);
+    RemoveSwap(prev_x, slot);
+    RemoveSwap(prev_y, slot);
+    RemoveSwap(speed_x, slot);
+    RemoveSwap(speed_y, slot);
+    RemoveSwap(dir, slot);
+    RemoveSwap(play_time, slot);
+    RemoveSwap(stop_time, slot);
+    RemoveSwap(is_move, slot);
+    RemoveSwap(seg_time, slot);
+    RemoveSwap(end_time, slot);
+    RemoveSwap(end_x, slot);
+    RemoveSwap(end_y, slot);
+    RemoveSwap(join_time, slot);
+    RemoveSwap(idle_since, slot);
+    RemoveSwap(epoch, slot);
+    RemoveSwap(next_x_, slot);
+    RemoveSwap(next_y_, slot);
+}
+
+void DogStates::SetDirection(size_t slot, Direction direction, double speed) {
+    dir[slot] = direction;
+    switch(direction) {
+        case Direction::LEFT:  speed_x[slot] = -speed; speed_y[slot] = 0.0;    break;
+        case Direction::RIGHT: speed_x[slot] = speed;  speed_y[slot] = 0.0;    break;
+        case Direction::UP:    speed_x[slot] = 0.0;    speed_y[slot] = -speed; break;
+        case Direction::DOWN:  speed_x[slot] = 0.0;    speed_y[slot] = speed;  break;
+        case Direction::NONE:  speed_x[slot] = 0.0;    speed_y[slot] = 0.0;    break;
+    }
+
+    if(direction != Direction::NONE) {
+        is_move[slot] = 1;
+    }
+}
+
+void DogStates::Reorder(std::span<const size_t> order) {
+    // Циклы перестановки находятся один раз и применяются ко всем массивам
+    cycle_starts_.clear();
+    visited_.assign(order.size(), 0);
+    for(size_t start = 0; start < order.size(); ++start) {
+        if(visited_[start] || order[start] == start) {
+            continue;
+        }
+        cycle_starts_.push_back(start);
+        for(size_t slot = start; !visited_[slot]; slot = order[slot]) {
+            visited_[slot] = 1;
+        }
+    }
+
+    Permute(x, order, cycle_starts_);
+    Permute(y, order, cycle_starts_);
+    Permute(prev_x, order, cycle_starts_);
+    Permute(prev_y, order, cycle_starts_);
+    Permute(speed_x, order, cycle_starts_);
+    Permute(speed_y, order, cycle_starts_);
+    Permute(dir, order, cycle_starts_);
+    Permute(play_time, order, cycle_starts_);
+    Permute(stop_time, order, cycle_starts_);
+    Permute(is_move, order, cycle_starts_);
+    Permute(seg_time, order, cycle_starts_);
+    Permute(end_time, order, cycle_starts_);
+    Permute(end_x, order, cycle_starts_);
+    Permute(end_y, order, cycle_starts_);
+    Permute(join_time, order, cycle_starts_);
+    Permute(idle_since, order, cycle_starts_);
+    Permute(epoch, order, cycle_starts_);
+    // next_x_ и next_y_ перезаписываются каждым перемещением, переставлять их не нужно
+}
+
+void MoveDogs(DogStates& dogs, const RoadIndex& roads, int delta) {
+    MoveDogs(dogs, roads, delta, 0, dogs.Size());
+}
+
+// Перемещение выполняется проходами по массивам. Все проходы, кроме поиска дорог под собакой,
+// не содержат ветвлений и обращений по указателям, поэтому компилятор их векторизует.
+void MoveDogs(DogStates& dogs, const RoadIndex& roads, int delta, size_t begin, size_t end) {
+    double* x        = dogs.x.data();
+    double* y        = dogs.y.data();
+    double* prev_x   = dogs.prev_x.data();
+    double* prev_y   = dogs.prev_y.data();
+    double* speed_x  = dogs.speed_x.data();
+    double* speed_y  = dogs.speed_y.data();
+    double* next_x   = dogs.next_x_.data();
+    double* next_y   = dogs.next_y_.data();
+    double* play     = dogs.play_time.data();
+    double* stop     = dogs.stop_time.data();
+    std::uint8_t* is_move = dogs.is_move.data();
+
+    // 1. Позиция, в которую собака придёт без учёта границ дорог
+    for(size_t i = begin; i < end; ++i) {
+        prev_x[i] = x[i];
+        prev_y[i] = y[i];
+        next_x[i] = x[i] + (speed_x[i] * delta / MILLISECONDS_IN_SECOND);
+        next_y[i] = y[i] + (speed_y[i] * delta / MILLISECONDS_IN_SECOND);
+    }
+
+    // 2. Ограничение перемещения краями дорог, на которых стоит собака.
+    //    Из всех дорог выбирается та, что позволяет уйти дальше всего.
+    for(size_t i = begin; i < end; ++i) {
+        const double vx = speed_x[i];
+        const double vy = speed_y[i];
+        const double target_x = next_x[i];
+        const double target_y = next_y[i];
+        double new_x = x[i];
+        double new_y = y[i];
+        if(vx != 0.0 || vy != 0.0) {
+            roads.ForEachRoadAt(x[i], y[i], [&](const RoadBounds& bounds) {
+                if(vx > 0) {
+                    new_x = std::max(new_x, std::min(target_x, bounds.max_x));
+                } else if(vx < 0) {
+                    new_x = std::min(new_x, std::max(target_x, bounds.min_x));
+                } else if(vy > 0) {
+                    new_y = std::max(new_y, std::min(target_y, bounds.max_y));
+                } else {
+                    new_y = std::min(new_y, std::max(target_y, bounds.min_y));
+                }
+            });
+        }
+        next_x[i] = new_x;
+        next_y[i] = new_y;
+    }
+
+    // 3. Фиксация позиции. Упёршаяся в край дороги собака останавливается.
+    for(size_t i = begin; i < end; ++i) {
+        const bool stopped = next_x[i] == x[i] && next_y[i] == y[i];
+        speed_x[i] = stopped ? 0.0 : speed_x[i];
+        speed_y[i] = stopped ? 0.0 : speed_y[i];
+        x[i] = next_x[i];
+        y[i] = next_y[i];
+    }
+
+    // 4. Время в игре и время простоя
+    const double dt = static_cast<double>(delta) / MILLISECONDS_IN_SECOND;
+    for(size_t i = begin; i < end; ++i) {
+        const bool idle = is_move[i] == 0 && speed_x[i] == 0.0 && speed_y[i] == 0.0;
+        play[i] += dt;
+        stop[i] = idle ? stop[i] + dt : 0.0;
+        is_move[i] = 0;
+    }
+}
+
+geom::Point2D PositionAt(const DogStates& dogs, size_t slot, double time) noexcept {
+    if(time >= dogs.end_time[slot]) {
+        return geom::Point2D{dogs.end_x[slot], dogs.end_y[slot]};
+    }
+    const double dt = time - dogs.seg_time[slot];
+    return geom::Point2D{dogs.x[slot] + dogs.speed_x[slot] * dt, dogs.y[slot] + dogs.speed_y[slot] * dt};
+}
+
+// Как и в MoveDogs, из дорог под точкой выбирается та, что позволяет уйти дальше всего.
+// Край этой дороги может лежать на другой дороге, тогда путь продолжается по ней
+geom::Point2D FindStopPoint(const RoadIndex& roads, double x, double y, double vx, double vy) {
+    if(vx == 0.0 && vy == 0.0) {
+        return geom::Point2D{x, y};
+    }
+    for(;;) {
+        double reach_x = x;
+        double reach_y = y;
+        roads.ForEachRoadAt(x, y, [&](const RoadBounds& bounds) {
+            if(vx > 0) {
+                reach_x = std::max(reach_x, bounds.max_x);
+            } else if(vx < 0) {
+                reach_x = std::min(reach_x, bounds.min_x);
+            } else if(vy > 0) {
+                reach_y = std::max(reach_y, bounds.max_y);
+            } else {
+                reach_y = std::min(reach_y, bounds.min_y);
+            }
+        });
+        if(reach_x == x && reach_y == y) {
+            return geom::Point2D{x, y};
+        }
+        x = reach_x;
+        y = reach_y;
+    }
+}
+
+}  // namespace model
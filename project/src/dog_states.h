@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "road_index.h"
+
+namespace model {
+
+enum class Direction : std::uint8_t {
+    NONE,
+    UP,
+    DOWN,
+    LEFT,
+    RIGHT
+};
+
+// Разбор направления из запроса: "U", "D", "L", "R" или "" (остановка)
+std::optional<Direction> ParseDirection(std::string_view dir) noexcept;
+std::string_view DirectionToString(Direction dir) noexcept;
+
+/*
+ *  Состояние движения собак сессии в виде параллельных массивов (structure of arrays).
+ *  Собака сессии с индексом slot описывается элементами всех массивов с этим индексом,
+ *  поэтому игровой цикл проходит по плотным массивам чисел, а не по объектам собак.
+ */
+struct DogStates {
+    std::vector<double> x;
+    std::vector<double> y;
+    // Позиция собаки перед последним перемещением
+    std::vector<double> prev_x;
+    std::vector<double> prev_y;
+    std::vector<double> speed_x;
+    std::vector<double> speed_y;
+    std::vector<Direction> dir;
+    std::vector<double> play_time;
+    std::vector<double> stop_time;
+    // Было ли задано направление движения с момента прошлого тика
+    std::vector<std::uint8_t> is_move;
+
+    // Траектории событийного моделирования, время в секундах от начала сессии.
+    // Собака движется из (x, y) со скоростью (speed_x, speed_y) с момента seg_time
+    // и в момент end_time останавливается в (end_x, end_y)
+    std::vector<double> seg_time;
+    std::vector<double> end_time;
+    std::vector<double> end_x;
+    std::vector<double> end_y;
+    // Моменты подключения собаки и начала её простоя
+    std::vector<double> join_time;
+    std::vector<double> idle_since;
+    // Версия траектории, события других версий устарели
+    std::vector<std::uint64_t> epoch;
+
+    size_t Size() const noexcept;
+    // Ни одна собака не движется и не получала направление с прошлого перемещения
+    bool IsIdle() const noexcept;
+
+    // Добавляет собаку в конец массивов и возвращает её индекс
+    size_t Add(double pos_x, double pos_y);
+    // Удаляет собаку, перенося на её место последнюю
+    void Remove(size_t slot);
+
+    void SetDirection(size_t slot, Direction direction, double speed);
+
+    // Переставляет собак: собакой с индексом i становится прежняя собака с индексом order[i]
+    void Reorder(std::span<const size_t> order);
+
+private:
+    // Буферы кандидатов на новую позицию, переиспользуются между тиками
+    std::vector<double> next_x_;
+    std::vector<double> next_y_;
+    // Буферы разбора перестановки на циклы
+    std::vector<size_t> cycle_starts_;
+    std::vector<std::uint8_t> visited_;
+
+    friend void MoveDogs(DogStates& dogs, const RoadIndex& roads, int delta, size_t begin, size_t end);
+};
+
+// Перемещает всех собак сессии вдоль дорог за delta миллисекунд и обновляет их таймеры
+void MoveDogs(DogStates& dogs, const RoadIndex& roads, int delta);
+// То же для собак с индексами [begin, end). Вызовы для непересекающихся диапазонов можно выполнять параллельно
+void MoveDogs(DogStates& dogs, const RoadIndex& roads, int delta, size_t begin, size_t end);
+
+// Позиция собаки в момент time по её траектории
+geom::Point2D PositionAt(const DogStates& dogs, size_t slot, double time) noexcept;
+// Точка, в которой остановится собака, идущая из (x, y) в направлении скорости (vx, vy).
+// Собака проходит дорогу до конца и продолжает путь по дорогам, которые её продолжают
+geom::Point2D FindStopPoint(const RoadIndex& roads, double x, double y, double vx, double vy);
+
+}  // namespace model
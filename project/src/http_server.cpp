@@ -32,6 +32,10 @@ namespace http_server {
         if(ec) {
             return ReportError(ec, "read"sv);
         }
+        if(websocket::is_upgrade(request_) && HandleUpgrade(request_, stream_)) {
+            // Соединением дальше владеет обработчик WebSocket
+            return;
+        }
         std::string ip = stream_.socket().local_endpoint().address().to_string();
         HandleRequest(std::move(request_), std::move(ip));
     }
@@ -7,6 +7,7 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
 
 #include <iostream>
 
@@ -16,6 +17,7 @@ namespace net = boost::asio;
 using tcp = net::ip::tcp;
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 namespace sys = boost::system;
 
 static void ReportError(beast::error_code ec, std::string_view what) {
@@ -23,6 +25,13 @@ static void ReportError(beast::error_code ec, std::string_view what) {
         std::cerr << what << ": "sv << ec.message() << std::endl;
     }
 
+// Обработчик перехода на WebSocket по умолчанию: такие запросы обрабатываются как обычные HTTP-запросы
+struct NoUpgrade {
+    bool operator()(http::request<http::string_body>&, beast::tcp_stream&) const {
+        return false;
+    }
+};
+
 class SessionBase {
 public:
     // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -59,6 +68,8 @@ private:
 
     // Обработку запроса делегируем подклассу
     virtual void HandleRequest(HttpRequest&& request, std::string&& ip) = 0;
+    // Возвращает true, если подкласс забрал поток для работы по WebSocket
+    virtual bool HandleUpgrade(HttpRequest& request, beast::tcp_stream& stream) = 0;
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
@@ -68,13 +79,14 @@ private:
     HttpRequest request_;
 };
 
-template <typename RequestHandler>
-class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
+template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
+class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler, UpgradeHandler>> {
 public:
     template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
+    Session(tcp::socket&& socket, Handler&& request_handler, const UpgradeHandler& upgrade_handler = {})
         : SessionBase(std::move(socket))
-        , request_handler_(std::forward<Handler>(request_handler)) {}
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(upgrade_handler) {}
 private:
     void HandleRequest(HttpRequest&& request, std::string&& ip) override {
         // Захватываем умный указатель на текущий объект Session в лямбде,
@@ -85,22 +97,29 @@ private:
         });
     }
 
+    bool HandleUpgrade(HttpRequest& request, beast::tcp_stream& stream) override {
+        return upgrade_handler_(request, stream);
+    }
+
     std::shared_ptr<SessionBase> GetSharedThis() override {
         return this->shared_from_this();
     }
 
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
-template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
+class Listener : public std::enable_shared_from_this<Listener<RequestHandler, UpgradeHandler>> {
 public:
     template <typename Handler>
-    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler,
+             UpgradeHandler upgrade_handler = {})
         : ioc_(ioc)
         // Обработчики асинхронных операция acceptor_ будут вызываться в своем strand
         , acceptor_(net::make_strand(ioc))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(std::move(upgrade_handler)) {
             // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
             acceptor_.open(endpoint.protocol());
 
@@ -152,12 +171,13 @@ private:
     }
 
     void AsyncRunSession(tcp::socket&& socket) {
-        std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+        std::make_shared<Session<RequestHandler, UpgradeHandler>>(std::move(socket), request_handler_, upgrade_handler_)->Run();
     }
 
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
 template <typename RequestHandler>
@@ -169,4 +189,15 @@ void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandl
     std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
 }
 
+// upgrade_handler(request, stream) получает запросы на переход к WebSocket. Если он забирает поток
+// и возвращает true, сессия HTTP завершается, иначе запрос обрабатывается как обычный
+template <typename RequestHandler, typename UpgradeHandler>
+void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+               UpgradeHandler&& upgrade_handler) {
+    using MyListener = Listener<std::decay_t<RequestHandler>, std::decay_t<UpgradeHandler>>;
+
+    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler),
+                                 std::forward<UpgradeHandler>(upgrade_handler))->Run();
+}
+
 }  // namespace http_server
@@ -8,6 +8,7 @@ namespace json_loader {
 static const float DEFAULT_DOG_SPEED = 1.0;
 static const float DEFAULT_DOG_RETIREMENT_TIME = 60.0;
 static const int   DEFAULT_BAG_CAPACITY = 3;
+static const size_t DEFAULT_MAX_PLAYERS = 0;
     
 boost::json::array GetArrayMaps(boost::json::value& json) {
     return json.at("maps").get_array();
@@ -53,6 +54,24 @@ float GetDogRetirementTime(boost::json::value& json) {
     return DEFAULT_DOG_RETIREMENT_TIME;
 }
 
+// Предел игроков сессии из конфигурации: 0 снимает ограничение, отрицательное значение - ошибка
+size_t GetPlayersLimit(boost::json::value& json, std::string_view key) {
+    const auto value = json.at(key).as_int64();
+    if(value < 0) {
+        throw std::logic_error(std::string{key} + " must not be negative");
+    }
+    return static_cast<size_t>(value);
+}
+
+// 0 - число игроков в сессии не ограничено
+size_t GetDefaultMaxPlayers(boost::json::value& json) {
+    if(json.as_object().contains("defaultMaxPlayers")) {
+        return GetPlayersLimit(json, "defaultMaxPlayers");
+    }
+
+    return DEFAULT_MAX_PLAYERS;
+}
+
 int GetDefaultBagCapacity(boost::json::value& json) {
     if(json.as_object().contains("defaultBagCapacity")) {
         return json.at("defaultBagCapacity").as_int64();
@@ -136,6 +155,14 @@ std::optional<int> GetBagCapacity(boost::json::value& json) {
     return std::nullopt;
 }
 
+std::optional<size_t> GetMaxPlayers(boost::json::value& json) {
+    if(json.as_object().contains("maxPlayers")) {
+        return GetPlayersLimit(json, "maxPlayers");
+    }
+
+    return std::nullopt;
+}
+
 model::Game LoadGame(const std::filesystem::path& json_path) {
     // Загрузить содержимое файла json_path, например, в виде строки
     // Распарсить строку как JSON, используя boost::json::parse
@@ -160,6 +187,7 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
     float loot_period        = GetLootGeneratorPeriod(json);
     float loot_probability   = GetLootGeneratorProbability(json);
     int default_bag_capacity = GetDefaultBagCapacity(json);
+    size_t default_max_players = GetDefaultMaxPlayers(json);
 
     int millisecondsValue = static_cast<int>(loot_period * 1000); // Конвертация float в миллисекунды
     std::chrono::milliseconds duration(millisecondsValue);
@@ -204,6 +232,11 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
                 map.SetBagCapacity(default_bag_capacity);
             }
         }
+        // Устанавливаем наибольшее число игроков в сессии карты
+        {
+            std::optional<size_t> max_players = GetMaxPlayers(value);
+            map.SetMaxPlayers(max_players ? *max_players : default_max_players);
+        }
 
         // Добавляем дороги на карте
         for(auto coord : roads) {
@@ -223,7 +256,7 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
             }
 
             map.AddRoad(*roadPtr);
-        }      
+        }
 
         // Добавляем офисы на карте
         for(auto coord : offices) {
@@ -240,9 +273,10 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
             model::Office office{tag_office_id, point, offset};
 
             map.AddOffice(office);
-        }   
+        }
+        map.CompileGeometry();
         
-        game.AddMap(map);
+        game.AddMap(std::move(map));
     }
 
     return game;
@@ -98,6 +98,11 @@ namespace http_handler {
             LogResponse(std::move(res_info), std::move(ip), std::chrono::duration<double, std::milli>(diff).count());
         }
 
+        // Запись о работе сервера, не связанной с запросами
+        void LogEvent(json::value data, std::string message) {
+            WriteLog(std::move(data), std::move(message));
+        }
+
     private:
         SomeRequestHandler& decorated_;
     };
@@ -10,6 +10,7 @@
 #include "json_loader.h"
 #include "request_handler.h"
 #include "logger_handler.h"
+#include "state_channel.h"
 
 #include "ticker.h"
 
@@ -28,6 +29,14 @@ struct Args {
 
     bool is_period = false;
     bool is_random = false;
+    std::optional<std::uint64_t> random_seed;
+    // Число потоков для параллельного обновления сессий, 1 - последовательное обновление
+    unsigned tick_threads = 1;
+    // Шаг моделирования в миллисекундах, по умолчанию равен периоду тика
+    std::optional<int> sim_step;
+    // Наибольший интервал обновления сессии, в которой никто не движется
+    std::optional<int> idle_tick_period;
+    bool is_event_driven = false;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -46,7 +55,20 @@ struct Args {
         // Опция --www-root (-w), задаёт путь к каталогу со статическими файлами игры
         ("www-root,w", po::value(&args.static_path)->value_name("dir"s), "set static files root")
         // Опция --randomize-spawn-points, включает режим, при котором пёс игрока появляется в случайной точке случайно выбранной дороги карты
-        ("randomize-spawn-points", "spawn dogs at random positions ");
+        ("randomize-spawn-points", "spawn dogs at random positions ")
+        // Опция --random-seed, фиксирует зерно генераторов случайных чисел сессий для воспроизводимых запусков
+        ("random-seed", po::value<std::uint64_t>()->value_name("seed"s), "set random seed")
+        // Опция --tick-threads, задаёт число потоков, между которыми распределяются сессии в игровом цикле. 0 - по числу ядер
+        ("tick-threads", po::value(&args.tick_threads)->value_name("count"s), "set number of threads updating game sessions")
+        // Опция --sim-step, задаёт фиксированный шаг моделирования в миллисекундах, на который делится время тиков
+        ("sim-step", po::value<int>()->value_name("milliseconds"s), "set fixed simulation step")
+        // Опция --idle-tick-period, включает адаптивную частоту: сессии без движения обновляются не чаще заданного периода.
+        // Частота не подстраивается под долю движущихся собак: сессия с хотя бы одной движущейся собакой
+        // обновляется на каждом шаге, иначе её клиенты видели бы движение рывками
+        ("idle-tick-period", po::value<int>()->value_name("milliseconds"s),
+            "set update period of sessions where no dog moves; a session with any moving dog is updated every simulation step")
+        // Опция --event-driven, включает событийное моделирование: собаки движутся по траекториям, а тик обрабатывает только их события
+        ("event-driven", "simulate dog motion by predicted events");
         
 
     // variables_map хранит значения опций после разбора
@@ -73,6 +95,23 @@ struct Args {
     if (vm.contains("randomize-spawn-points"s)) {
         args.is_random= true;
     }
+    if (vm.contains("event-driven"s)) {
+        args.is_event_driven = true;
+    }
+    if (vm.contains("random-seed"s)) {
+        args.random_seed = vm["random-seed"s].as<std::uint64_t>();
+    }
+    if (vm.contains("sim-step"s)) {
+        args.sim_step = vm["sim-step"s].as<int>();
+    } else if (args.is_period) {
+        args.sim_step = args.period;
+    }
+    if (vm.contains("idle-tick-period"s)) {
+        args.idle_tick_period = vm["idle-tick-period"s].as<int>();
+    }
+    if (args.tick_threads == 0) {
+        args.tick_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
 
 
     // С опциями программы всё в порядке, возвращаем структуру args
@@ -80,6 +119,23 @@ struct Args {
 }
 
 namespace {
+// Период записи статистики тиков в лог
+constexpr std::chrono::milliseconds TICK_STATS_PERIOD = 60s;
+
+// Ticker считает сроки таймера, пропущенные из-за долгого тика, а SimulationClock -
+// вызовы, в которых догоняние ограничено и часть игрового времени отброшена
+template <typename Logger>
+void LogTickStats(Logger& logger, const Ticker::Stats& ticker, const app::SimulationClock::Stats& clock) {
+    boost::json::value data{
+        {"ticks"s,                  ticker.ticks},
+        {"missed_tick_deadlines"s,  ticker.overruns},
+        {"simulation_steps"s,       clock.steps},
+        {"catch_up_capped"s,        clock.overruns},
+        {"catch_up_dropped_ms"s,    clock.dropped.count()}
+    };
+    logger.LogEvent(std::move(data), "tick stats"s);
+}
+
 // Запускает функцию fn на n потоках, включая текущий
 template <typename Fn>
 void RunWorkers(unsigned thread_cnt, const Fn& fn) {
@@ -113,6 +169,10 @@ int main(int argc, const char* argv[]) {
 
         // 1. Загружаем карту из файла и построить модель игры
         model::Game game = json_loader::LoadGame(args->config);
+        if(args->random_seed) {
+            game.SetRandomSeed(*args->random_seed);
+        }
+        game.SetEventDriven(args->is_event_driven);
 
         // 2. Инициализируем io_context
         const unsigned num_threads = std::thread::hardware_concurrency();
@@ -141,24 +201,57 @@ int main(int argc, const char* argv[]) {
         // Токены и игроки
         std::shared_ptr<app::PlayerTokens> tokens  = std::make_shared<app::PlayerTokens>();
         std::shared_ptr<app::Players>      players = std::make_shared<app::Players>();
+        // Вызывающий Tick поток сам обновляет часть сессий, поэтому пулу нужен на один поток меньше
+        std::shared_ptr<app::WorkerPool> tick_workers;
+        if(args->tick_threads > 1) {
+            tick_workers = std::make_shared<app::WorkerPool>(args->tick_threads - 1);
+        }
         // Объект Application содержит сценарии использования
-        app::Application app {game, tokens, players, args->is_random, args->is_period, use_cases};
+        app::Application app {game, tokens, players, args->is_random, args->is_period, use_cases, tick_workers};
+        if(args->sim_step) {
+            app.SetSimulationStep(std::chrono::milliseconds{*args->sim_step});
+        }
+        if(args->idle_tick_period) {
+            app.SetIdleTickPeriod(std::chrono::milliseconds{*args->idle_tick_period});
+        }
+
+        auto handler = std::make_shared<http_handler::RequestHandler>(app, args->static_path, api_strand);
+        // Подписчики WebSocket и запросы, ждущие новых снимков, оповещаются после каждой публикации снимков
+        auto state_channel = std::make_shared<http_handler::StateChannel>(app, api_strand);
+        app.SetPublishListener([state_channel, handler] {
+            state_channel->Broadcast();
+            handler->WakeStateWaiters();
+        });
 
         // Настраиваем вызов метода Application::Tick каждые n миллисекунд внутри strand
+        std::shared_ptr<Ticker> ticker;
         if(args->is_period) {
             std::chrono::milliseconds duration(args->period);
-            auto ticker = std::make_shared<Ticker>(api_strand, duration,
+            ticker = std::make_shared<Ticker>(api_strand, duration,
                 [&app](std::chrono::milliseconds delta) { app.Tick(delta); }
             );
             ticker->Start();
         }
 
-        auto handler = std::make_shared<http_handler::RequestHandler>(app, args->static_path, api_strand);
         http_handler::LoggingRequestHandler<http_handler::RequestHandler> loging_handler{*handler, port, ip};
 
+        // Периодически пишем в лог, успевает ли сервер за таймером. Запись идёт в strand тика,
+        // поэтому статистика часов моделирования читается без гонок
+        std::shared_ptr<Ticker> stats_ticker;
+        if(ticker) {
+            stats_ticker = std::make_shared<Ticker>(api_strand, TICK_STATS_PERIOD,
+                [&app, &loging_handler, ticker](std::chrono::milliseconds) {
+                    LogTickStats(loging_handler, ticker->GetStats(), app.GetTickStats());
+                }
+            );
+            stats_ticker->Start();
+        }
+
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         http_server::ServeHttp(ioc, {address, port}, [&loging_handler](std::string&& ip, auto&& req, auto&& send) {
             loging_handler(std::forward<std::string>(ip), std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+        }, [state_channel](auto& req, auto& stream) {
+            return state_channel->Upgrade(req, stream);
         });
         
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "alias_table.h"
+#include "geom.h"
+
+namespace model {
+
+// Допуск проверки точки на дороге. Позиция собаки накапливает ошибку округления, поэтому собака,
+// остановившаяся на краю дороги, может оказаться чуть за ним
+inline constexpr double ROAD_BOUNDS_EPSILON = 1e-9;
+
+// Границы дороги с учётом её ширины
+struct RoadBounds {
+    double min_x = 0.0;
+    double min_y = 0.0;
+    double max_x = 0.0;
+    double max_y = 0.0;
+
+    bool Contains(double x, double y) const noexcept {
+        return min_x - ROAD_BOUNDS_EPSILON <= x && x <= max_x + ROAD_BOUNDS_EPSILON &&
+               min_y - ROAD_BOUNDS_EPSILON <= y && y <= max_y + ROAD_BOUNDS_EPSILON;
+    }
+};
+
+// Ось дороги с упорядоченными концами: x0 <= x1, y0 <= y1
+struct RoadSegment {
+    double x0 = 0.0;
+    double y0 = 0.0;
+    double x1 = 0.0;
+    double y1 = 0.0;
+};
+
+// Дороги одного направления в виде параллельных массивов
+struct RoadArrays {
+    std::vector<RoadBounds> bounds;
+    std::vector<RoadSegment> segments;
+
+    size_t Count() const noexcept {
+        return segments.size();
+    }
+};
+
+/*
+ *  Скомпилированная геометрия карты.
+ *  Строится один раз при загрузке, все координаты в ней уже нормализованы,
+ *  а границы дорог расширены на их ширину, поэтому игровой цикл ничего не пересчитывает.
+ */
+struct MapGeometry {
+    RoadArrays horizontal;
+    RoadArrays vertical;
+    std::vector<geom::Point2D> offices;
+    // Выбор дороги с вероятностью, пропорциональной её длине. Дороги пронумерованы
+    // как в RoadsCount(): сначала горизонтальные, затем вертикальные
+    util::AliasTable road_sampler;
+
+    size_t RoadsCount() const noexcept {
+        return horizontal.Count() + vertical.Count();
+    }
+};
+
+}  // namespace model
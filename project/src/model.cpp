@@ -1,11 +1,21 @@
 #include "model.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <stdexcept>
+#include <utility>
 #include <iostream>
 
 namespace model {
 using namespace std::literals;
 
+namespace {
+constexpr double MILLISECONDS_IN_SECOND = 1000.0;
+// Сколько событий на собаку допускается в очереди до удаления устаревших
+constexpr size_t MOTION_EVENTS_PER_DOG = 8;
+}  // namespace
+
 bool operator<=(const Coordinate& coord, const Point& point) {
     return coord.x < point.x && coord.y < point.y;
 }
@@ -14,21 +24,114 @@ bool operator>=(const Coordinate& coord, const Point& point) {
     return coord.x > point.x && coord.y > point.y;
 }
 
-void LostObjects::AddObject(const Coordinate& coord, size_t type) {
-    objects_.emplace_back(std::make_tuple(id_++, coord, type));
+LostObjects::Handle LostObjects::MakeHandle(std::uint32_t slot, std::uint32_t generation) noexcept {
+    return (static_cast<Handle>(generation) << SLOT_BITS) | slot;
+}
+
+std::optional<std::uint32_t> LostObjects::FindSlot(Handle handle) const noexcept {
+    const auto slot       = static_cast<std::uint32_t>(handle);
+    const auto generation = static_cast<std::uint32_t>(handle >> SLOT_BITS);
+    if(slot >= slots_.size() || slots_[slot].generation != generation) {
+        return std::nullopt;
+    }
+    return slot;
+}
+
+size_t LostObjects::FindEntry(Id id) const noexcept {
+    // id выдаются подряд, поэтому их младшие биты равномерно распределяют элементы по таблице
+    const size_t mask = id_table_.size() - 1;
+    size_t pos = id & mask;
+    while(id_table_[pos].handle != NO_HANDLE && id_table_[pos].id != id) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+void LostObjects::InsertEntry(Id id, Handle handle) {
+    // Таблица растёт вдвое, когда заполняется наполовину
+    if(2 * (objects_.size() + 1) > id_table_.size()) {
+        std::vector<IdEntry> entries(std::max<size_t>(16, 2 * id_table_.size()));
+        entries.swap(id_table_);
+        for(const auto& entry : entries) {
+            if(entry.handle != NO_HANDLE) {
+                id_table_[FindEntry(entry.id)] = entry;
+            }
+        }
+    }
+    id_table_[FindEntry(id)] = IdEntry{id, handle};
+}
+
+void LostObjects::EraseEntry(size_t pos) noexcept {
+    // Элементы той же цепочки сдвигаются на освободившееся место, чтобы поиск не обрывался на нём.
+    // Элемент переносится, если его начальная позиция не лежит между освободившейся и текущей
+    const size_t mask = id_table_.size() - 1;
+    for(size_t next = (pos + 1) & mask; id_table_[next].handle != NO_HANDLE; next = (next + 1) & mask) {
+        const size_t home = id_table_[next].id & mask;
+        if(((next - home) & mask) >= ((next - pos) & mask)) {
+            id_table_[pos] = id_table_[next];
+            pos = next;
+        }
+    }
+    id_table_[pos] = IdEntry{};
+}
+
+LostObjects::Id LostObjects::AddObject(const Coordinate& pos, size_t type) {
+    std::uint32_t slot;
+    if(!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = static_cast<std::uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+
+    const Id id = next_id_++;
+    InsertEntry(id, MakeHandle(slot, slots_[slot].generation));
+    slots_[slot].index = static_cast<std::uint32_t>(objects_.size());
+    objects_.emplace_back(Object{id, pos, type});
+    object_slots_.emplace_back(slot);
+    return id;
 }
 
-void LostObjects::DeleteObject(size_t id) {
-    objects_.erase(std::remove_if(objects_.begin(), objects_.end(), [id](const Object& obj) {
-        return std::get<0>(obj) == id;
-    }), objects_.end());
+bool LostObjects::DeleteObject(Id id) {
+    if(id_table_.empty()) {
+        return false;
+    }
+    const size_t entry = FindEntry(id);
+    const auto slot = id_table_[entry].handle != NO_HANDLE ? FindSlot(id_table_[entry].handle) : std::nullopt;
+    if(!slot) {
+        return false;
+    }
+    EraseEntry(entry);
+
+    // Последний предмет занимает место удаляемого
+    const std::uint32_t index = slots_[*slot].index;
+    objects_[index] = objects_.back();
+    object_slots_[index] = object_slots_.back();
+    slots_[object_slots_[index]].index = index;
+    objects_.pop_back();
+    object_slots_.pop_back();
+
+    // Новое поколение делает прежнюю ссылку на ячейку недействительной
+    ++slots_[*slot].generation;
+    free_slots_.emplace_back(*slot);
+    return true;
 }
 
-size_t LostObjects::GetCountObjects() const {
+const LostObjects::Object* LostObjects::FindObject(Id id) const noexcept {
+    if(id_table_.empty()) {
+        return nullptr;
+    }
+    const IdEntry& entry = id_table_[FindEntry(id)];
+    const auto slot = entry.handle != NO_HANDLE ? FindSlot(entry.handle) : std::nullopt;
+    return slot ? &objects_[slots_[*slot].index] : nullptr;
+}
+
+size_t LostObjects::GetCountObjects() const noexcept {
     return objects_.size();
 }
 
-std::vector<LostObjects::Object> LostObjects::GetObjects() const {
+std::span<const LostObjects::Object> LostObjects::GetObjects() const noexcept {
     return objects_;
 }
 
@@ -40,7 +143,11 @@ void Bag::FreeBag() {
     objects_.clear();
 }
 
-std::vector<Bag::Object> Bag::GetBag() const {
+void Bag::Reserve(size_t capacity) {
+    objects_.reserve(capacity);
+}
+
+const std::vector<Bag::Object>& Bag::GetBag() const noexcept {
     return objects_;
 }
 
@@ -88,6 +195,14 @@ int Map::GetBagCapacity() const {
     return bag_capacity_;
 }
 
+void Map::SetMaxPlayers(size_t max_players) {
+    max_players_ = max_players;
+}
+
+size_t Map::GetMaxPlayers() const noexcept {
+    return max_players_;
+}
+
 size_t Map::GetLootTypesCount() const {
     return loot_types_.GetLootCount();
 }
@@ -108,23 +223,11 @@ Dog::Id Dog::GetId() const {
     return id_;
 }
 
-std::string Dog::GetName() const {
+const std::string& Dog::GetName() const noexcept {
     return name_;
 }
 
-Coordinate Dog::GetPos() const {
-    return pos_;
-}
-
-std::string Dog::GetDir() const {
-    return dir_;
-}
-
-Speed Dog::GetSpeed() const {
-    return speed_;
-}
-
-std::vector<Bag::Object> Dog::GetBagObjects() const {
+const std::vector<Bag::Object>& Dog::GetBagObjects() const noexcept {
     return bag_.GetBag();
 }
 
@@ -132,33 +235,6 @@ size_t Dog::GetScore() const {
     return score_;
 }
 
-void Dog::SetPos(const Coordinate& pos) {
-    pos_ = pos;
-}
-
-void Dog::SetDir(std::string_view dir, double speed) {
-    dir_ = dir;
-
-    if(dir_ == "L"sv) {
-        speed_ = Speed{-speed, 0.0};
-    } else if(dir_ == "R"sv) {
-        speed_ = Speed{speed, 0.0};
-    } else if(dir_ == "U"sv) {
-        speed_ = Speed{0.0, -speed};
-    } else if(dir_ == "D"sv) {
-        speed_ = Speed{0.0, speed};
-    } else if(dir_ == ""sv) {
-        speed_ = Speed{0.0, 0.0};
-    }
-
-    if (dir_ != ""sv)
-        is_move_ = true;
-}
-
-void Dog::SetSpeed(const Speed& speed) {
-    speed_ = speed;
-}
-
 void Dog::AddItem(size_t id, size_t type, size_t score) {
     ++items_count_;
     score_ += score;
@@ -170,67 +246,151 @@ void Dog::FreeItems() {
     bag_.FreeBag();
 }
 
+void Dog::ReserveBag(size_t capacity) {
+    bag_.Reserve(capacity);
+}
+
 int Dog::GetItemsCount() const {
     return items_count_;
 }
 
-void Dog::AddPlayTime(const double t) {
-    play_time_ += t;
-    if(!is_move_ && speed_.horizont == 0 && speed_.vertical == 0) {
-        stop_time_ += t;
-    } else {
-        stop_time_ = 0;
-    }
+size_t Dog::GetSlot() const {
+    return slot_;
+}
+
+void Dog::SetSlot(size_t slot) {
+    slot_ = slot;
+}
 
-    is_move_ = false;
+std::vector<SessionSnapshot::Trajectory>& SessionSnapshot::DeferPositions(double time) {
+    positions_.time = time;
+    positions_.pending.store(true, std::memory_order_relaxed);
+    return positions_.trajectories;
 }
 
-double Dog::GetStopTime() const {
-    return stop_time_;
+void SessionSnapshot::SetPositionsResolved() noexcept {
+    positions_.pending.store(false, std::memory_order_relaxed);
 }
 
-double Dog::GetPlayTime() const {
-    return play_time_;
+void SessionSnapshot::ResolvePositions() {
+    if(!positions_.pending.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard lock{positions_.mutex};
+    if(!positions_.pending.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Позиция вычисляется так же, как PositionAt по состоянию сессии
+    const double time = positions_.time;
+    for(size_t i = 0; i < dogs.size(); ++i) {
+        const Trajectory& trajectory = positions_.trajectories[i];
+        if(time >= trajectory.end_time) {
+            dogs[i].pos = trajectory.end;
+            continue;
+        }
+        const double dt = time - trajectory.start_time;
+        dogs[i].pos = Coordinate{trajectory.start.x + trajectory.speed.horizont * dt,
+                                 trajectory.start.y + trajectory.speed.vertical * dt};
+    }
+    positions_.pending.store(false, std::memory_order_release);
 }
 
 GameSession::Id GameSession::GetId() const {
     return id_;
 }
 
-std::shared_ptr<GameSession::Dogs> GameSession::GetDogs() const {
-    return std::make_shared<Dogs>(dogs_);
+std::span<const std::shared_ptr<Dog>> GameSession::GetDogs() const noexcept {
+    return dogs_;
+}
+
+DogStates& GameSession::GetDogStates() noexcept {
+    return states_;
+}
+
+const DogStates& GameSession::GetDogStates() const noexcept {
+    return states_;
+}
+
+Coordinate GameSession::GetDogPos(const Dog& dog) const {
+    if(event_driven_) {
+        const geom::Point2D pos = PositionAt(states_, dog.GetSlot(), Now());
+        return Coordinate{pos.x, pos.y};
+    }
+    return Coordinate{states_.x[dog.GetSlot()], states_.y[dog.GetSlot()]};
+}
+
+Speed GameSession::GetDogSpeed(const Dog& dog) const {
+    if(event_driven_ && states_.end_time[dog.GetSlot()] <= Now()) {
+        return Speed{};
+    }
+    return Speed{states_.speed_x[dog.GetSlot()], states_.speed_y[dog.GetSlot()]};
+}
+
+Direction GameSession::GetDogDir(const Dog& dog) const {
+    return states_.dir[dog.GetSlot()];
 }
 
-int GetRandomInt(int min, int max) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dist(min, max);
+void GameSession::SetDogDir(const Dog& dog, Direction dir) {
+    const size_t slot = dog.GetSlot();
+    changed_ = true;
+    if(!event_driven_) {
+        states_.SetDirection(slot, dir, map_->GetDogSpeed());
+        return;
+    }
 
-    return dist(gen);
+    // Новая траектория начинается из текущей позиции и идёт до точки остановки
+    const double now = Now();
+    const bool was_moving = states_.end_time[slot] > now;
+    const geom::Point2D pos = PositionAt(states_, slot, now);
+    states_.SetDirection(slot, dir, map_->GetDogSpeed());
+    states_.is_move[slot] = 0;
+    const geom::Point2D stop = FindStopPoint(map_->GetRoadIndex(), pos.x, pos.y,
+                                             states_.speed_x[slot], states_.speed_y[slot]);
+    const double distance = std::abs(stop.x - pos.x) + std::abs(stop.y - pos.y);
+    states_.x[slot] = pos.x;
+    states_.y[slot] = pos.y;
+    states_.end_x[slot] = stop.x;
+    states_.end_y[slot] = stop.y;
+    states_.seg_time[slot] = now;
+    states_.end_time[slot] = distance > 0.0 ? now + distance / map_->GetDogSpeed() : now;
+    if(distance == 0.0) {
+        states_.speed_x[slot] = 0.0;
+        states_.speed_y[slot] = 0.0;
+    }
+    moving_until_ = std::max(moving_until_, states_.end_time[slot]);
+
+    // Команда движения сбрасывает простой до остановки, а остановка движущейся собаки начинает его
+    if(dir != Direction::NONE) {
+        states_.idle_since[slot] = states_.end_time[slot];
+    } else if(was_moving) {
+        states_.idle_since[slot] = now;
+    }
+    ScheduleDog(slot);
 }
 
-double GetRandomDouble(double min, double max) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<double> dist(min, max);
+namespace {
+int GetRandomInt(util::RandomEngine& random, int min, int max) {
+    return min + static_cast<int>(random.NextBelow(static_cast<std::uint64_t>(max - min) + 1));
+}
 
-    double rand = dist(gen);
+double GetRandomDouble(util::RandomEngine& random, double min, double max) {
+    double rand = min + (max - min) * random.NextDouble();
     return std::round(rand * 10) / 10;
 }
+}  // namespace
 
-Coordinate GameSession::GetRandomCoordinate() const {
-    auto roads = map_.GetRoads();
-    int random = GetRandomInt(0, roads.size() - 1);
-    auto road  = roads[random];
-    Point start = road.GetStart();
-    Point end   = road.GetEnd();
+Coordinate GameSession::GetRandomCoordinate() {
+    const MapGeometry& geometry = map_->GetGeometry();
+    size_t random = geometry.road_sampler.Sample(random_);
     double x, y;
-    if(road.IsHorizontal()) {
-        x = GetRandomDouble(start.x, end.x);
-        y = start.y;
+    if(random < geometry.horizontal.Count()) {
+        const RoadSegment& road = geometry.horizontal.segments[random];
+        x = GetRandomDouble(random_, road.x0, road.x1);
+        y = road.y0;
     } else {
-        x = start.x;
-        y = GetRandomDouble(start.y, end.y);
+        const RoadSegment& road = geometry.vertical.segments[random - geometry.horizontal.Count()];
+        x = road.x0;
+        y = GetRandomDouble(random_, road.y0, road.y1);
     }
 
     return Coordinate{x, y};
@@ -242,40 +402,86 @@ void GameSession::AddDog(std::shared_ptr<Dog> dogPtr, bool is_random) {
     if(is_random) {
         coord = GetRandomCoordinate();
     } else {   // Размещаем пса в начальной точке координат
-        auto roads = map_.GetRoads();
-        coord.x = roads[0].GetStart().x;
-        coord.y = roads[0].GetStart().y;
+        const Road& road = map_->GetRoads().front();
+        coord.x = road.GetStart().x;
+        coord.y = road.GetStart().y;
     }
 
-    dogPtr->SetPos(coord);
+    const size_t slot = states_.Add(coord.x, coord.y);
+    dogPtr->SetSlot(slot);
+    dogPtr->ReserveBag(map_->GetBagCapacity());
     dogs_.emplace_back(dogPtr);
+    ++roster_version_;
+    changed_ = true;
+
+    if(event_driven_) {
+        const double now = Now();
+        states_.seg_time[slot]   = now;
+        states_.end_time[slot]   = now;
+        states_.join_time[slot]  = now;
+        states_.idle_since[slot] = now;
+        ScheduleDog(slot);
+    }
 }
 
 void GameSession::DeleteDog(std::shared_ptr<Dog> dogPtr) {
-    for(auto it = dogs_.begin(); it != dogs_.end(); it++) {
-        auto dog = *it;
-        if(dogPtr->GetId() == dog->GetId()) {
-            dogs_.erase(it);
-            return;
-        }
+    const size_t slot = dogPtr->GetSlot();
+    if(slot >= dogs_.size() || dogs_[slot]->GetId() != dogPtr->GetId()) {
+        return;
+    }
+    // Последняя собака занимает место удаляемой
+    dogs_[slot] = dogs_.back();
+    dogs_[slot]->SetSlot(slot);
+    dogs_.pop_back();
+    states_.Remove(slot);
+    ++roster_version_;
+    changed_ = true;
+
+    // События перенесённой собаки предсказаны для её прежнего индекса
+    if(event_driven_ && slot < dogs_.size()) {
+        ScheduleDog(slot);
     }
 }
 
 void GameSession::AddLoot() {
-    size_t     type  = GetRandomInt(0, map_.GetLootTypesCount() - 1);
+    size_t     type  = GetRandomInt(random_, 0, map_->GetLootTypesCount() - 1);
     Coordinate coord = GetRandomCoordinate();
 
-    lost_objects_.AddObject(coord, type);
+    const LostObjects::Id id = lost_objects_.AddObject(coord, type);
+    changed_ = true;
+    if(event_driven_) {
+        motion_grid_.AddLoot(id, coord.x, coord.y);
+        ScheduleLootPickups(*lost_objects_.FindObject(id));
+    }
 }
 
-void GameSession::DeliteLoot(size_t id) {
+size_t GameSession::GenerateLoot(std::chrono::milliseconds time_delta) {
+    size_t generate_count = loot_generator_.Generate(time_delta, LootCount(), DogsCount());
+    for(size_t i = 0; i < generate_count; i++) {
+        AddLoot();
+    }
+    return generate_count;
+}
+
+void GameSession::DeliteLoot(LostObjects::Id id) {
+    if(event_driven_) {
+        if(const auto* loot = lost_objects_.FindObject(id)) {
+            motion_grid_.RemoveLoot(id, loot->pos.x, loot->pos.y);
+        }
+    }
     lost_objects_.DeleteObject(id);
+    changed_ = true;
 }
 
-std::vector<LostObjects::Object> GameSession::GetLootObjects() const {
+std::span<const LostObjects::Object> GameSession::GetLootObjects() const noexcept {
     return lost_objects_.GetObjects();
 }
 
+bool GameSession::HasDog(const Dog& dog) const noexcept {
+    const size_t slot = dog.GetSlot();
+    return slot < dogs_.size() && dogs_[slot].get() == &dog;
+}
+
 size_t GameSession::DogsCount() const {
     return dogs_.size();
 }
@@ -284,8 +490,310 @@ size_t GameSession::LootCount() const {
     return lost_objects_.GetCountObjects();
 }
 
-const Map GameSession::GetMap() const {
-    return map_;
+const Map& GameSession::GetMap() const noexcept {
+    return *map_;
+}
+
+const LostObjects::Object* GameSession::FindLoot(LostObjects::Id id) const noexcept {
+    return lost_objects_.FindObject(id);
+}
+
+void GameSession::SetEventDriven(double retirement_time) {
+    event_driven_ = true;
+    retirement_time_ = retirement_time;
+    motion_grid_.Reset(map_->GetRoadIndex());
+}
+
+bool GameSession::IsEventDriven() const noexcept {
+    return event_driven_;
+}
+
+std::int64_t GameSession::GetTime() const noexcept {
+    return time_;
+}
+
+double GameSession::Now() const noexcept {
+    return static_cast<double>(time_) / MILLISECONDS_IN_SECOND;
+}
+
+std::optional<MotionEvent> GameSession::NextGatherEvent(std::int64_t until) {
+    const double until_time = static_cast<double>(until) / MILLISECONDS_IN_SECOND;
+    while(!motion_events_.Empty() && motion_events_.Top().time <= until_time) {
+        const MotionEvent event = motion_events_.Top();
+        motion_events_.Pop();
+        if(event.slot >= dogs_.size() || states_.epoch[event.slot] != event.epoch) {
+            continue;
+        }
+
+        const size_t slot = event.slot;
+        switch(event.type) {
+            case MotionEventType::STOP:
+                states_.x[slot] = states_.end_x[slot];
+                states_.y[slot] = states_.end_y[slot];
+                states_.speed_x[slot] = 0.0;
+                states_.speed_y[slot] = 0.0;
+                states_.seg_time[slot] = states_.end_time[slot];
+                break;
+            case MotionEventType::RETIRE:
+                // Таймеры вычисляются только к уходу, по ним собаку удаляет игровой цикл
+                states_.stop_time[slot] = retirement_time_;
+                states_.play_time[slot] = event.time - states_.join_time[slot];
+                break;
+            case MotionEventType::LOOT:
+            case MotionEventType::OFFICE:
+                return event;
+        }
+    }
+    time_ = std::max(time_, until);
+    return std::nullopt;
+}
+
+size_t GameSession::PendingMotionEvents() const noexcept {
+    return motion_events_.Size();
+}
+
+void GameSession::ScheduleDog(size_t slot) {
+    // Устаревшие события удаляются, когда их накапливается больше действительных
+    if(motion_events_.Size() > 2 * motion_events_live_ + MOTION_EVENTS_PER_DOG * dogs_.size()) {
+        motion_events_.EraseIf([this](const MotionEvent& event) {
+            return event.slot >= dogs_.size() || states_.epoch[event.slot] != event.epoch;
+        });
+        motion_events_live_ = motion_events_.Size();
+    }
+    if(motion_grid_.PathsCount() > 2 * motion_paths_live_ + MOTION_EVENTS_PER_DOG * dogs_.size()) {
+        const double now = Now();
+        motion_grid_.ErasePathsIf([this, now](const MotionGrid::PathRef& path) {
+            return !IsPathLive(path, now);
+        });
+        motion_paths_live_ = motion_grid_.PathsCount();
+    }
+
+    const double now = Now();
+    const std::uint64_t epoch = states_.epoch[slot] = ++motion_epoch_;
+    motion_events_.Push(MotionEvent{states_.idle_since[slot] + retirement_time_, slot, epoch, MotionEventType::RETIRE});
+
+    const double end_time = states_.end_time[slot];
+    if(end_time <= now) {
+        return;
+    }
+    motion_events_.Push(MotionEvent{end_time, slot, epoch, MotionEventType::STOP});
+
+    // Подбор предметов и посещение офисов на оставшейся части пути
+    const geom::Point2D start = PositionAt(states_, slot, now);
+    const geom::Point2D end{states_.end_x[slot], states_.end_y[slot]};
+    if(start == end) {
+        return;
+    }
+    const double duration = end_time - now;
+    // Проверяются только предметы из ячеек, через которые проходит путь
+    const double min_x = std::min(start.x, end.x) - Dog::WIDTH;
+    const double min_y = std::min(start.y, end.y) - Dog::WIDTH;
+    const double max_x = std::max(start.x, end.x) + Dog::WIDTH;
+    const double max_y = std::max(start.y, end.y) + Dog::WIDTH;
+    motion_grid_.ForEachLootIn(min_x, min_y, max_x, max_y, [&](const MotionGrid::LootRef& loot) {
+        const auto result = collision_detector::TryCollectPoint(start, end, geom::Point2D{loot.x, loot.y});
+        if(result.IsCollected(Dog::WIDTH)) {
+            motion_events_.Push(MotionEvent{now + result.proj_ratio * duration, slot, epoch, MotionEventType::LOOT, loot.id});
+        }
+    });
+    motion_grid_.AddPath(slot, epoch, min_x, min_y, max_x, max_y);
+
+    const collision_detector::Gatherer gatherer{start, end, Dog::WIDTH};
+    collision_detector::FindGatherEvents(map_->GetOfficeIndex(), {&gatherer, 1}, office_events_, motion_scratch_);
+    for(const auto& event : office_events_) {
+        motion_events_.Push(MotionEvent{now + event.time * duration, slot, epoch, MotionEventType::OFFICE, event.item_id});
+    }
+}
+
+void GameSession::ScheduleLootPickups(const LostObjects::Object& loot) {
+    const double now = Now();
+    const geom::Point2D point{loot.pos.x, loot.pos.y};
+    // Проверяются только собаки, чей путь проходит через ячейку предмета
+    motion_grid_.ForEachPathAt(point.x, point.y, [&](const MotionGrid::PathRef& path) {
+        if(!IsPathLive(path, now)) {
+            return false;
+        }
+        const size_t slot = path.slot;
+        const double end_time = states_.end_time[slot];
+        const geom::Point2D start = PositionAt(states_, slot, now);
+        const geom::Point2D end{states_.end_x[slot], states_.end_y[slot]};
+        if(start == end) {
+            return true;
+        }
+        const auto result = collision_detector::TryCollectPoint(start, end, point);
+        if(result.IsCollected(Dog::WIDTH)) {
+            motion_events_.Push(MotionEvent{now + result.proj_ratio * (end_time - now), slot, path.epoch,
+                                            MotionEventType::LOOT, loot.id});
+        }
+        return true;
+    });
+}
+
+bool GameSession::IsPathLive(const MotionGrid::PathRef& path, double now) const noexcept {
+    return path.slot < dogs_.size() && states_.epoch[path.slot] == path.epoch && states_.end_time[path.slot] > now;
+}
+
+void GameSession::MarkChanged() noexcept {
+    changed_ = true;
+}
+
+bool GameSession::PublishSnapshot() {
+    if(event_driven_ && moving_until_ > published_time_) {
+        changed_ = true;
+    }
+    if(!changed_) {
+        return false;
+    }
+    changed_ = false;
+
+    const std::uint64_t version = snapshot_version_ + 1;
+    auto& history_slot = snapshot_history_[version % SNAPSHOT_HISTORY];
+    // Снимок, выходящий из истории, изымается из кольца до проверки, чтобы читатели не получили его во время записи
+    std::shared_ptr<SessionSnapshot> snapshot = std::atomic_exchange(&history_slot, std::shared_ptr<SessionSnapshot>{});
+    if(!snapshot || snapshot.use_count() != 1) {
+        snapshot = std::make_shared<SessionSnapshot>();
+    }
+    // Читатели прежнего снимка закончили с ним работу до освобождения ссылок
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    snapshot_version_        = version;
+    snapshot->version        = version;
+    snapshot->roster_version = roster_version_;
+    snapshot->dogs.resize(dogs_.size());
+    for(size_t slot = 0; slot < dogs_.size(); ++slot) {
+        const Dog& dog = *dogs_[slot];
+        auto& info = snapshot->dogs[slot];
+        info.id    = dog.GetId();
+        info.name  = dog.GetName();
+        info.speed = GetDogSpeed(dog);
+        info.dir   = GetDogDir(dog);
+        info.bag.reserve(map_->GetBagCapacity());
+        info.bag.assign(dog.GetBagObjects().begin(), dog.GetBagObjects().end());
+        info.score = dog.GetScore();
+    }
+    const auto loot = lost_objects_.GetObjects();
+    snapshot->loot.assign(loot.begin(), loot.end());
+
+    // Позиции движущихся собак событийной сессии меняются каждый тик, поэтому вычисляются только для прочитанных снимков
+    if(event_driven_) {
+        published_time_ = Now();
+        auto& trajectories = snapshot->DeferPositions(published_time_);
+        trajectories.resize(dogs_.size());
+        for(size_t slot = 0; slot < dogs_.size(); ++slot) {
+            auto& trajectory = trajectories[slot];
+            trajectory.start      = Coordinate{states_.x[slot], states_.y[slot]};
+            trajectory.speed      = Speed{states_.speed_x[slot], states_.speed_y[slot]};
+            trajectory.start_time = states_.seg_time[slot];
+            trajectory.end        = Coordinate{states_.end_x[slot], states_.end_y[slot]};
+            trajectory.end_time   = states_.end_time[slot];
+        }
+    } else {
+        for(size_t slot = 0; slot < dogs_.size(); ++slot) {
+            snapshot->dogs[slot].pos = Coordinate{states_.x[slot], states_.y[slot]};
+        }
+        snapshot->SetPositionsResolved();
+    }
+
+    std::atomic_store(&history_slot, snapshot);
+    std::atomic_store(&snapshot_, std::move(snapshot));
+    return true;
+}
+
+std::shared_ptr<const SessionSnapshot> GameSession::GetSnapshot() const {
+    std::shared_ptr<SessionSnapshot> snapshot = std::atomic_load(&snapshot_);
+    if(snapshot) {
+        snapshot->ResolvePositions();
+    }
+    return snapshot;
+}
+
+std::shared_ptr<const SessionSnapshot> GameSession::GetSnapshot(std::uint64_t version) const {
+    std::shared_ptr<SessionSnapshot> snapshot = std::atomic_load(&snapshot_history_[version % SNAPSHOT_HISTORY]);
+    if(!snapshot || snapshot->version != version) {
+        return nullptr;
+    }
+    snapshot->ResolvePositions();
+    return snapshot;
+}
+
+int GameSession::GetDeferredTime() const noexcept {
+    return deferred_time_;
+}
+
+void GameSession::DeferTime(int delta) noexcept {
+    deferred_time_ += delta;
+}
+
+int GameSession::TakeDeferredTime() noexcept {
+    return std::exchange(deferred_time_, 0);
+}
+
+void GameSession::SplitIntoRegions(size_t count) {
+    count = std::max<size_t>(count, 1);
+    if(count == regions_count_) {
+        return;
+    }
+
+    // Полосы покрывают все дороги карты
+    const MapGeometry& geometry = map_->GetGeometry();
+    double min_x = 0.0, max_x = 0.0;
+    bool first = true;
+    for(const RoadArrays* arrays : {&geometry.horizontal, &geometry.vertical}) {
+        for(const RoadBounds& bounds : arrays->bounds) {
+            min_x = first ? bounds.min_x : std::min(min_x, bounds.min_x);
+            max_x = first ? bounds.max_x : std::max(max_x, bounds.max_x);
+            first = false;
+        }
+    }
+
+    regions_count_ = count;
+    regions_min_x_ = min_x;
+    region_width_  = std::max((max_x - min_x) / count, 1e-9);
+}
+
+size_t GameSession::RegionOf(double x) const noexcept {
+    const double region = std::floor((x - regions_min_x_) / region_width_);
+    return static_cast<size_t>(std::clamp(region, 0.0, static_cast<double>(regions_count_ - 1)));
+}
+
+void GameSession::RegroupDogs() {
+    const size_t count = dogs_.size();
+    region_offsets_.assign(regions_count_ + 1, 0);
+    dog_regions_.resize(count);
+
+    bool grouped = true;
+    for(size_t slot = 0; slot < count; ++slot) {
+        dog_regions_[slot] = RegionOf(states_.x[slot]);
+        grouped = grouped && (slot == 0 || dog_regions_[slot - 1] <= dog_regions_[slot]);
+        ++region_offsets_[dog_regions_[slot] + 1];
+    }
+    for(size_t r = 0; r < regions_count_; ++r) {
+        region_offsets_[r + 1] += region_offsets_[r];
+    }
+    if(grouped) {
+        return;
+    }
+
+    // Устойчивая сортировка подсчётом: собаки, не покинувшие полосу, сохраняют взаимный порядок
+    regroup_order_.resize(count);
+    region_fill_.assign(region_offsets_.begin(), region_offsets_.end() - 1);
+    for(size_t slot = 0; slot < count; ++slot) {
+        regroup_order_[region_fill_[dog_regions_[slot]]++] = slot;
+    }
+
+    states_.Reorder(regroup_order_);
+    // Буфер после обмена хранит перемещённые указатели и сохраняет ёмкость до следующей перегруппировки
+    regrouped_dogs_.clear();
+    for(size_t slot = 0; slot < count; ++slot) {
+        regrouped_dogs_.emplace_back(std::move(dogs_[regroup_order_[slot]]));
+        regrouped_dogs_.back()->SetSlot(slot);
+    }
+    dogs_.swap(regrouped_dogs_);
+    regrouped_dogs_.clear();
+}
+
+std::span<const size_t> GameSession::GetRegionOffsets() const noexcept {
+    return region_offsets_;
 }
 
 void Game::SetDogRetirementTime(const float dog_retirement_time) {
@@ -296,13 +804,30 @@ const float Game::GetDogRetirementTime() const {
     return dog_retirement_time_;
 }
 
+void Game::SetRandomSeed(std::uint64_t seed) {
+    random_seed_ = seed;
+}
+
+void Game::SetEventDriven(bool event_driven) {
+    event_driven_ = event_driven;
+}
+
+std::uint64_t Game::MakeSessionSeed(GameSession::Id id) const {
+    if(!random_seed_) {
+        return util::RandomSeed();
+    }
+    // Зерно сессии зависит от общего зерна и номера сессии
+    std::uint64_t state = *random_seed_ ^ *id;
+    return util::SplitMix64(state);
+}
+
 void Game::AddMap(Map map) {
     const size_t index = maps_.size();
     if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
         throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
     } else {
         try {
-            maps_.emplace_back(std::move(map));
+            maps_.emplace_back(std::make_shared<const Map>(std::move(map)));
         } catch (...) {
             map_id_to_index_.erase(it);
             throw;
@@ -346,9 +871,65 @@ void Map::AddBuilding(const Building& building) {
     buildings_.emplace_back(building);
 }
 
-const Map* Game::FindMap(const Map::Id& id) const noexcept {
+void Map::CompileGeometry() {
+    geometry_ = MapGeometry{};
+    for(const auto& road : roads_) {
+        Point start = road.GetStart();
+        Point end   = road.GetEnd();
+        RoadSegment segment{static_cast<double>(std::min(start.x, end.x)),
+                            static_cast<double>(std::min(start.y, end.y)),
+                            static_cast<double>(std::max(start.x, end.x)),
+                            static_cast<double>(std::max(start.y, end.y))};
+        RoadBounds bounds{segment.x0 - Road::HALF_WIDTH, segment.y0 - Road::HALF_WIDTH,
+                          segment.x1 + Road::HALF_WIDTH, segment.y1 + Road::HALF_WIDTH};
+
+        RoadArrays& arrays = road.IsHorizontal() ? geometry_.horizontal : geometry_.vertical;
+        arrays.segments.emplace_back(segment);
+        arrays.bounds.emplace_back(bounds);
+    }
+
+    // Точка, выбранная на случайной дороге, равномерно распределена по всей дорожной сети
+    std::vector<double> road_lengths;
+    road_lengths.reserve(geometry_.RoadsCount());
+    for(const auto& segment : geometry_.horizontal.segments) {
+        road_lengths.emplace_back(segment.x1 - segment.x0);
+    }
+    for(const auto& segment : geometry_.vertical.segments) {
+        road_lengths.emplace_back(segment.y1 - segment.y0);
+    }
+    geometry_.road_sampler = util::AliasTable{road_lengths};
+
+    geometry_.offices.reserve(offices_.size());
+    for(const auto& office : offices_) {
+        Point pos = office.GetPosition();
+        geometry_.offices.emplace_back(pos.x, pos.y);
+    }
+
+    road_index_ = RoadIndex{geometry_};
+
+    std::vector<collision_detector::Item> office_items;
+    office_items.reserve(geometry_.offices.size());
+    for(const auto& office : geometry_.offices) {
+        office_items.emplace_back(collision_detector::Item{office, Office::WIDTH});
+    }
+    office_index_ = collision_detector::ItemIndex{office_items};
+}
+
+const MapGeometry& Map::GetGeometry() const noexcept {
+    return geometry_;
+}
+
+const RoadIndex& Map::GetRoadIndex() const noexcept {
+    return road_index_;
+}
+
+const collision_detector::ItemIndex& Map::GetOfficeIndex() const noexcept {
+    return office_index_;
+}
+
+Game::MapPtr Game::FindMap(const Map::Id& id) const noexcept {
     if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
-        return &maps_.at(it->second);
+        return maps_[it->second];
     }
     return nullptr;
 }
@@ -358,26 +939,32 @@ const Game::Maps& Game::GetMaps() const noexcept {
 }
 
 void Game::AddSession(std::shared_ptr<GameSession> session) {
-    const size_t index = sessions_.size();
-    if (auto [it, inserted] = map_id_to_session_index_.emplace(session->GetMap().GetId(), index); !inserted) {
-        throw std::invalid_argument("Map with id "s + *session->GetMap().GetId() + " already exists"s);
-    } else {
-        try {
-            sessions_.emplace_back(session);
-        } catch (...) {
-            map_id_to_session_index_.erase(it);
-            throw;
-        }
+    auto& indices = map_id_to_session_indices_[session->GetMap().GetId()];
+    indices.emplace_back(sessions_.size());
+    try {
+        sessions_.emplace_back(session);
+    } catch (...) {
+        indices.pop_back();
+        throw;
     }
 }
 
 std::shared_ptr<GameSession> Game::FindSession(const Map::Id& id) const {
-    if (auto it = map_id_to_session_index_.find(id); it != map_id_to_session_index_.end()) {
-        return sessions_.at(it->second);
+    auto it = map_id_to_session_indices_.find(id);
+    if (it == map_id_to_session_indices_.end()) {
+        return nullptr;
+    }
+    // Новые игроки дополняют самую раннюю незаполненную сессию
+    for (size_t index : it->second) {
+        const auto& session = sessions_[index];
+        const size_t max_players = session->GetMap().GetMaxPlayers();
+        if (max_players == 0 || session->DogsCount() < max_players) {
+            return session;
+        }
     }
     return nullptr;
 }
-std::vector<std::shared_ptr<GameSession>> Game::GetSessions() const {
+const std::vector<std::shared_ptr<GameSession>>& Game::GetSessions() const noexcept {
     return sessions_;
 }
 
@@ -386,10 +973,14 @@ const std::shared_ptr<GameSession> Game::ConnectToSession(Map::Id map_id, std::s
     if(!map) {
         throw std::invalid_argument("Map with id "s + *map_id + " does not exist"s);
     }
-    // Ищем подходящую сессию, если не нашли - создаем новую
+    // Ищем сессию со свободным местом, если не нашли - создаем новую
     std::shared_ptr<GameSession> sessionPtr = FindSession(map_id);
     if(!sessionPtr) {
-        sessionPtr = std::make_shared<GameSession>(GameSession::Id{SessionId::GetId()}, *map);
+        GameSession::Id session_id{SessionId::GetId()};
+        sessionPtr = std::make_shared<GameSession>(session_id, map, MakeSessionSeed(session_id), *loot_generator_);
+        if(event_driven_) {
+            sessionPtr->SetEventDriven(dog_retirement_time_);
+        }
         AddSession(sessionPtr);
     }
 
@@ -397,8 +988,4 @@ const std::shared_ptr<GameSession> Game::ConnectToSession(Map::Id map_id, std::s
     return sessionPtr;
 }
 
-size_t Game::LootGenerate(std::chrono::milliseconds time_delta, unsigned loot_count, unsigned looter_count) {
-    return loot_generator_->Generate(time_delta, loot_count, looter_count);
-}
-
 }  // namespace model
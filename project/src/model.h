@@ -1,18 +1,30 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <iostream>
 #include <cmath>
 #include <optional>
 #include <tuple>
+#include <span>
 
 #include "tagged.h"
+#include "random_engine.h"
 #include "loot_generator.h"
 #include "extra_data.h"
 #include "tagged_uuid.h"
+#include "map_geometry.h"
+#include "road_index.h"
+#include "dog_states.h"
+#include "motion_events.h"
+#include "motion_grid.h"
+#include "collision_detector.h"
 
 namespace model {
 
@@ -22,11 +34,15 @@ using Coord = Dimension;
 struct Speed {
     double horizont = 0.0;
     double vertical = 0.0;
+
+    bool operator==(const Speed&) const = default;
 };
  
 struct Coordinate {
     double x = 0.0;
     double y = 0.0;
+
+    bool operator==(const Coordinate&) const = default;
 };
 
 struct Point {
@@ -50,17 +66,68 @@ bool operator<=(const Coordinate& coord, const Point& point);
 
 bool operator>=(const Coordinate& coord, const Point& point);
 
+/*
+ *  Потерянные предметы сессии - slot map с поколениями.
+ *  Предметы лежат в плотном массиве, а ячейка хранит позицию предмета в нём.
+ *  Добавление и удаление выполняются за O(1), удалённый предмет заменяется последним.
+ *  Клиенты видят id предметов, которые выдаются по возрастанию, как счётчиком, и не используются повторно.
+ *  Таблица с открытой адресацией связывает id с ячейкой: младшие 32 бита её ссылки - номер ячейки,
+ *  старшие - поколение, которое растёт при каждом освобождении ячейки.
+ */
 class LostObjects {
 public:
-    using Object = std::tuple<size_t, Coordinate, size_t>;
+    using Id = size_t;
+
+    struct Object {
+        Id id;
+        Coordinate pos;
+        size_t type;
+    };
+
+    Id AddObject(const Coordinate& pos, size_t type);
+    // Возвращает false, если предмета с таким id уже нет
+    bool DeleteObject(Id id);
+    const Object* FindObject(Id id) const noexcept;
+    size_t GetCountObjects() const noexcept;
+    // Предметы без копирования. Представление действительно до добавления или удаления предмета
+    std::span<const Object> GetObjects() const noexcept;
 
-    void AddObject(const Coordinate&, size_t);
-    void DeleteObject(size_t);
-    size_t GetCountObjects() const;
-    std::vector<Object> GetObjects() const;
 private:
-    size_t id_ = 0;
+    // Ячейка с поколением, упакованные в одно число. Известна только LostObjects,
+    // клиенты видят возрастающие id предметов
+    using Handle = std::uint64_t;
+
+    struct Slot {
+        std::uint32_t generation = 0;
+        // Позиция предмета в objects_, пока ячейка занята
+        std::uint32_t index = 0;
+    };
+
+    // Элемент таблицы id -> ячейка с открытой адресацией
+    struct IdEntry {
+        Id id = 0;
+        Handle handle = NO_HANDLE;
+    };
+
+    static constexpr unsigned SLOT_BITS = 32;
+    static constexpr Handle NO_HANDLE = ~Handle{0};
+
+    static Handle MakeHandle(std::uint32_t slot, std::uint32_t generation) noexcept;
+    // Номер занятой ячейки или nullopt, если предмет удалён
+    std::optional<std::uint32_t> FindSlot(Handle handle) const noexcept;
+    // Позиция id в id_table_ или позиция свободного элемента, куда его можно записать
+    size_t FindEntry(Id id) const noexcept;
+    void InsertEntry(Id id, Handle handle);
+    void EraseEntry(size_t pos) noexcept;
+
+    Id next_id_ = 0;
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+    // Размер таблицы - степень двойки, заполнена не больше чем наполовину
+    std::vector<IdEntry> id_table_;
+    // objects_[i] занимает ячейку object_slots_[i]
     std::vector<Object> objects_;
+    std::vector<std::uint32_t> object_slots_;
 };
 
 class Bag {
@@ -69,8 +136,10 @@ public:
 
     void AddObject(size_t id, size_t type);
     void FreeBag();
+    // Резервирует место под capacity предметов, чтобы подбор не выделял память
+    void Reserve(size_t capacity);
 
-    std::vector<Object> GetBag() const;
+    const std::vector<Object>& GetBag() const noexcept;
 private:
     std::vector<Object> objects_;
 };
@@ -87,6 +156,8 @@ class Road {
 public:
     constexpr static HorizontalTag HORIZONTAL{};
     constexpr static VerticalTag VERTICAL{};
+    // Расстояние от оси дороги до её края
+    constexpr static double HALF_WIDTH = 0.4;
 
     Road(HorizontalTag, Point start, Coord end_x) noexcept
         : start_{start}
@@ -125,6 +196,9 @@ class Office {
 public:
     using Id = util::Tagged<std::string, Office>;
 
+    // Ширина офиса при сдаче в него предметов
+    constexpr static double WIDTH = 0.25;
+
     Office(Id id, Point position, Offset offset) noexcept
         : id_{std::move(id)}
         , position_{position}
@@ -188,10 +262,25 @@ public:
 
     int GetBagCapacity() const;
 
+    // Наибольшее число игроков в одной сессии карты, 0 - без ограничения
+    void SetMaxPlayers(size_t max_players);
+
+    size_t GetMaxPlayers() const noexcept;
+
     size_t GetLootTypesCount() const;
 
     size_t GetScoreLootType(size_t type) const;
 
+    // Компилирует геометрию карты и индекс дорог, вызывается после добавления всех дорог и офисов
+    void CompileGeometry();
+
+    const MapGeometry& GetGeometry() const noexcept;
+
+    const RoadIndex& GetRoadIndex() const noexcept;
+
+    // Офисы карты неподвижны, поэтому индексируются один раз при компиляции геометрии
+    const collision_detector::ItemIndex& GetOfficeIndex() const noexcept;
+
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
@@ -199,7 +288,11 @@ private:
     std::string name_;
     double dog_speed_ = 1.0;
     int bag_capacity_ = 3;
+    size_t max_players_ = 0;
     Roads roads_;
+    MapGeometry geometry_;
+    RoadIndex road_index_;
+    collision_detector::ItemIndex office_index_;
     Buildings buildings_;
     std::string config_;
 
@@ -209,46 +302,39 @@ private:
     extra_data::LootTypes loot_types_;
 };
 
+// Собака хранит данные игрока, а её позиция, скорость и таймеры
+// лежат в DogStates сессии под индексом GetSlot()
 class Dog {
 public:
     using Id = util::Tagged<size_t, Dog>;
 
+    // Ширина собаки при подборе предметов
+    constexpr static double WIDTH = 0.3;
+
     Dog(Id id, std::string name)
         : id_{id}
         , name_(move(name)) {}
 
     Id GetId() const;
-    std::string GetName() const;
-    Coordinate GetPos() const;
-    std::string GetDir() const;
-    Speed GetSpeed() const;
-    std::vector<Bag::Object> GetBagObjects() const;
+    const std::string& GetName() const noexcept;
+    const std::vector<Bag::Object>& GetBagObjects() const noexcept;
     size_t GetScore() const;
 
-    void SetPos(const Coordinate& pos);
-    void SetDir(std::string_view dir, double speed);
-    void SetSpeed(const Speed& speed);
-
     void AddItem(size_t id, size_t type, size_t score);
     void FreeItems();
+    void ReserveBag(size_t capacity);
     int GetItemsCount() const;
 
-    void AddPlayTime(const double t);
-    double GetStopTime() const;
-    double GetPlayTime() const;
+    size_t GetSlot() const;
+    void SetSlot(size_t slot);
 
 private:
     Id id_;
     std::string name_;
-    Coordinate pos_;
-    Speed speed_;
-    std::string dir_ = "U";
     int items_count_ = 0;
     Bag bag_;
     size_t score_ = 0;
-    double play_time_ = 0.0;
-    double stop_time_ = 0.0;
-    bool is_move_ = false;
+    size_t slot_ = 0;
 };
 
 // Создает уникальные id собак
@@ -267,37 +353,214 @@ private:
     inline static size_t id_ = 0;
 };
 
+// Неизменяемый снимок сессии, по которому отвечают запросы чтения
+struct SessionSnapshot {
+    struct DogInfo {
+        Dog::Id id{0};
+        std::string name;
+        Coordinate pos;
+        Speed speed;
+        Direction dir = Direction::NONE;
+        std::vector<Bag::Object> bag;
+        size_t score = 0;
+
+        bool operator==(const DogInfo&) const = default;
+    };
+
+    // Отрезок пути собаки событийной сессии: из start в момент start_time со скоростью speed до end в момент end_time
+    struct Trajectory {
+        Coordinate start;
+        Speed speed;
+        double start_time = 0.0;
+        Coordinate end;
+        double end_time = 0.0;
+    };
+
+    // Номер публикации, растёт с каждым снимком изменившейся сессии
+    std::uint64_t version = 0;
+    // Номер состава собак, меняется только при подключении и уходе собак
+    std::uint64_t roster_version = 0;
+    std::vector<DogInfo> dogs;
+    std::vector<LostObjects::Object> loot;
+
+    // Снимок событийной сессии публикуется с траекториями собак, а позиции в dogs вычисляются по ним
+    // на момент time при первом чтении. Возвращает траектории, которые публикующий поток заполняет по одной на собаку.
+    // Снимки, полученные от GameSession::GetSnapshot, уже содержат позиции
+    std::vector<Trajectory>& DeferPositions(double time);
+    // Снимок публикуется с уже записанными позициями
+    void SetPositionsResolved() noexcept;
+    // Вычисляет отложенные позиции собак. Можно вызывать из нескольких потоков одновременно
+    void ResolvePositions();
+
+private:
+    // Копия снимка получает только вычисленные данные
+    struct PendingPositions {
+        double time = 0.0;
+        std::vector<Trajectory> trajectories;
+        std::mutex mutex;
+        std::atomic<bool> pending{false};
+
+        PendingPositions() = default;
+        PendingPositions(const PendingPositions&) {}
+        PendingPositions& operator=(const PendingPositions&) {
+            pending.store(false, std::memory_order_relaxed);
+            return *this;
+        }
+    };
+    PendingPositions positions_;
+};
+
 class GameSession {
 public:
     using Id = util::Tagged<size_t, GameSession>;
     using Dogs = std::vector<std::shared_ptr<Dog>>;
 
-    GameSession(Id id, Map map)
+    // seed задаёт последовательность случайных чисел сессии: место появления собак и предметов.
+    // Генератор трофеев у каждой сессии свой, поэтому сессии можно обновлять параллельно
+    GameSession(Id id, std::shared_ptr<const Map> map, std::uint64_t seed, loot_gen::LootGenerator loot_generator)
         : id_{id}
-        , map_{map} {}
+        , map_{std::move(map)}
+        , random_{seed}
+        , loot_generator_{std::move(loot_generator)} {}
         
     Id GetId() const;
-    std::shared_ptr<Dogs> GetDogs() const;
+    // Собаки сессии без копирования. Представление действительно до изменения состава сессии
+    std::span<const std::shared_ptr<Dog>> GetDogs() const noexcept;
+    DogStates& GetDogStates() noexcept;
+    const DogStates& GetDogStates() const noexcept;
+    Coordinate GetDogPos(const Dog& dog) const;
+    Speed GetDogSpeed(const Dog& dog) const;
+    Direction GetDogDir(const Dog& dog) const;
+    void SetDogDir(const Dog& dog, Direction dir);
+    // Находится ли собака в сессии
+    bool HasDog(const Dog& dog) const noexcept;
     size_t DogsCount() const;
     size_t LootCount() const;
     void AddDog(std::shared_ptr<Dog>, bool);
     void DeleteDog(std::shared_ptr<Dog>);
     void AddLoot();
-    void DeliteLoot(size_t);
-    std::vector<LostObjects::Object> GetLootObjects() const;
-    const Map GetMap() const;
-    Coordinate GetRandomCoordinate() const;
+    // Добавляет трофеи, появившиеся за time_delta, и возвращает их количество
+    size_t GenerateLoot(std::chrono::milliseconds time_delta);
+    void DeliteLoot(LostObjects::Id);
+    std::span<const LostObjects::Object> GetLootObjects() const noexcept;
+    const Map& GetMap() const noexcept;
+    Coordinate GetRandomCoordinate();
+
+    const LostObjects::Object* FindLoot(LostObjects::Id id) const noexcept;
+
+    // Включает событийное моделирование, вызывается до подключения собак.
+    // Собака движется по прямой до остановки, а её позиция вычисляется по запросу.
+    // Остановки, уход из игры, подбор предметов и посещение офисов предсказываются при смене
+    // направления и появлении предметов, поэтому работа зависит от числа событий, а не собак
+    void SetEventDriven(double retirement_time);
+    bool IsEventDriven() const noexcept;
+    // Время событийной сессии в миллисекундах
+    std::int64_t GetTime() const noexcept;
+    // Обрабатывает остановки и уход собак до момента until и возвращает ближайшее событие подбора
+    // предмета или посещения офиса не позже until. Если таких нет, время сессии становится равным until
+    std::optional<MotionEvent> NextGatherEvent(std::int64_t until);
+    // Число событий в очереди вместе с ещё не удалёнными устаревшими
+    size_t PendingMotionEvents() const noexcept;
+
+    // Отмечает изменение, которое сессия не видит сама: например, подбор предмета или сдачу рюкзака собакой.
+    // Смена направления, состав собак и предметы на карте отмечаются самой сессией
+    void MarkChanged() noexcept;
+    // Публикует снимок текущего состояния сессии, если оно изменилось с прошлой публикации, и возвращает,
+    // опубликован ли снимок. Вызывается потоком, который изменяет сессию. Событийная сессия меняется, пока движется
+    // хотя бы одна собака, но позиции собак в её снимке вычисляются только при первом чтении.
+    // Последние SNAPSHOT_HISTORY снимков хранятся в кольце: следующий снимок записывается на место
+    // вышедшего из истории, если его уже никто не читает, поэтому в установившемся режиме публикация не выделяет память
+    bool PublishSnapshot();
+    // Последний опубликованный снимок. Можно вызывать из любого потока одновременно с обновлением сессии
+    std::shared_ptr<const SessionSnapshot> GetSnapshot() const;
+    // Снимок с номером version или nullptr, если он уже вышел из истории
+    std::shared_ptr<const SessionSnapshot> GetSnapshot(std::uint64_t version) const;
+
+    static constexpr size_t SNAPSHOT_HISTORY = 32;
+
+    // Время, которое бездействующая сессия ещё не смоделировала, в миллисекундах
+    int GetDeferredTime() const noexcept;
+    void DeferTime(int delta) noexcept;
+    // Возвращает отложенное время и обнуляет его
+    int TakeDeferredTime() noexcept;
+
+    // Делит карту на count вертикальных полос одинаковой ширины для параллельного обновления сессии
+    void SplitIntoRegions(size_t count);
+    // Передаёт собак, пересёкших границы полос, в их новые полосы. После вызова собаки
+    // каждой полосы занимают подряд идущие индексы, а индексы собак могут измениться
+    void RegroupDogs();
+    // Собаки полосы r занимают индексы [offsets[r], offsets[r + 1]). Действительно после RegroupDogs
+    std::span<const size_t> GetRegionOffsets() const noexcept;
 
 private:
     Id id_;
+    // dogs_[i] описывается элементами states_ с индексом i
     Dogs dogs_;
-    Map map_;
+    DogStates states_;
+    std::shared_ptr<const Map> map_;
     LostObjects lost_objects_;
+    util::RandomEngine random_;
+    loot_gen::LootGenerator loot_generator_;
+
+    int deferred_time_ = 0;
+
+    // Опубликованный снимок заменяется атомарно. Читатели получают его неизменяемым после вычисления позиций
+    std::shared_ptr<SessionSnapshot> snapshot_;
+    // Снимок с номером v хранится в snapshot_history_[v % SNAPSHOT_HISTORY], ячейки заменяются атомарно
+    std::array<std::shared_ptr<SessionSnapshot>, SNAPSHOT_HISTORY> snapshot_history_;
+    std::uint64_t snapshot_version_ = 0;
+    std::uint64_t roster_version_ = 0;
+    // Состояние изменилось после последней публикации
+    bool changed_ = true;
+    // Время событийной сессии при последней публикации и наибольшее время остановки собак в секундах.
+    // Пока собаки движутся после публикации, их позиции в снимке устаревают
+    double published_time_ = 0.0;
+    double moving_until_ = 0.0;
+
+    // Событийное моделирование
+    bool event_driven_ = false;
+    double retirement_time_ = 0.0;
+    std::int64_t time_ = 0;
+    std::uint64_t motion_epoch_ = 0;
+    MotionQueue motion_events_;
+    // Число действительных событий после последнего удаления устаревших
+    size_t motion_events_live_ = 0;
+    // Предметы и пути движущихся собак по ячейкам сетки дорог
+    MotionGrid motion_grid_;
+    // Число записанных путей после последнего удаления устаревших
+    size_t motion_paths_live_ = 0;
+    // Буферы поиска офисов на пути собаки
+    collision_detector::GatherScratch motion_scratch_;
+    std::vector<collision_detector::GatheringEvent> office_events_;
+
+    // Время сессии в секундах
+    double Now() const noexcept;
+    // Предсказывает события оставшейся части траектории собаки, прежние события устаревают
+    void ScheduleDog(size_t slot);
+    // Предсказывает подбор нового предмета движущимися собаками
+    void ScheduleLootPickups(const LostObjects::Object& loot);
+    // Путь записан для текущей траектории собаки, и она ещё движется
+    bool IsPathLive(const MotionGrid::PathRef& path, double now) const noexcept;
+
+    // Полосы карты: полоса r начинается с x = regions_min_x_ + r * region_width_
+    size_t regions_count_ = 1;
+    double regions_min_x_ = 0.0;
+    double region_width_ = 1.0;
+    std::vector<size_t> region_offsets_;
+    // Буферы перегруппировки собак
+    std::vector<size_t> dog_regions_;
+    std::vector<size_t> regroup_order_;
+    std::vector<size_t> region_fill_;
+    Dogs regrouped_dogs_;
+
+    size_t RegionOf(double x) const noexcept;
 };
 
 class Game {
 public:
-    using Maps = std::vector<Map>;
+    // Карты неизменяемы после загрузки и разделяются между игрой и всеми её сессиями
+    using MapPtr = std::shared_ptr<const Map>;
+    using Maps = std::vector<MapPtr>;
 
     Game() {}
     explicit Game(std::shared_ptr<loot_gen::LootGenerator> loot_generator)
@@ -305,33 +568,48 @@ public:
 
     void AddMap(Map map);
     const Maps& GetMaps() const noexcept;
-    const Map* FindMap(const Map::Id& id) const noexcept;
+    MapPtr FindMap(const Map::Id& id) const noexcept;
 
     void AddSession(std::shared_ptr<GameSession> session);
+    // Сессия карты, в которой есть свободное место, или nullptr, если все сессии карты заполнены
     std::shared_ptr<GameSession> FindSession(const Map::Id& id) const;
-    std::vector<std::shared_ptr<GameSession>> GetSessions() const;
+    const std::vector<std::shared_ptr<GameSession>>& GetSessions() const noexcept;
 
     const std::shared_ptr<GameSession> ConnectToSession(Map::Id map_id, std::shared_ptr<Dog> dog, bool random);
 
-    size_t LootGenerate(std::chrono::milliseconds time_delta, unsigned loot_count, unsigned looter_count);
-
     void SetDogRetirementTime(const float dog_retirement_time);
 
     const float GetDogRetirementTime() const;
 
+    // С фиксированным зерном случайные события всех сессий воспроизводятся от запуска к запуску
+    void SetRandomSeed(std::uint64_t seed);
+
+    // Новые сессии используют событийное моделирование движения собак
+    void SetEventDriven(bool event_driven);
+
 private:
     using MapIdHasher  = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
 
-    std::vector<Map> maps_;
+    Maps maps_;
     MapIdToIndex map_id_to_index_;
 
+    using MapIdToSessionIndices = std::unordered_map<Map::Id, std::vector<size_t>, MapIdHasher>;
+
     std::vector<std::shared_ptr<GameSession>> sessions_;
-    MapIdToIndex map_id_to_session_index_;
+    // Когда сессия карты заполнена, для новых игроков открывается ещё одна сессия той же карты
+    MapIdToSessionIndices map_id_to_session_indices_;
 
+    // Настройки генератора трофеев, каждая новая сессия получает его копию
     std::shared_ptr<loot_gen::LootGenerator> loot_generator_;
 
     float dog_retirement_time_;
+
+    std::optional<std::uint64_t> random_seed_;
+
+    bool event_driven_ = false;
+
+    std::uint64_t MakeSessionSeed(GameSession::Id id) const;
 };
 
 }  // namespace model
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace model {
+
+enum class MotionEventType : std::uint8_t {
+    // Собака дошла до конца дороги
+    STOP,
+    // Собака простояла без команд время ухода из игры
+    RETIRE,
+    // Собака проходит через потерянный предмет
+    LOOT,
+    // Собака проходит через офис
+    OFFICE
+};
+
+// Предсказанное событие траектории собаки
+struct MotionEvent {
+    // Время сессии в секундах
+    double time = 0.0;
+    size_t slot = 0;
+    // Версия траектории собаки, для которой предсказано событие
+    std::uint64_t epoch = 0;
+    MotionEventType type = MotionEventType::STOP;
+    // Для LOOT - id предмета, для OFFICE - номер офиса
+    size_t target = 0;
+};
+
+/*
+ *  Очередь предсказанных событий с приоритетом по времени.
+ *  События одного времени извлекаются в порядке добавления, поэтому моделирование детерминировано.
+ *  Устаревшие события не удаляются при смене траектории, а пропускаются при извлечении.
+ */
+class MotionQueue {
+public:
+    void Push(const MotionEvent& event) {
+        heap_.push_back(Entry{event, next_seq_++});
+        std::push_heap(heap_.begin(), heap_.end(), Later{});
+    }
+
+    bool Empty() const noexcept {
+        return heap_.empty();
+    }
+
+    size_t Size() const noexcept {
+        return heap_.size();
+    }
+
+    const MotionEvent& Top() const noexcept {
+        return heap_.front().event;
+    }
+
+    void Pop() {
+        std::pop_heap(heap_.begin(), heap_.end(), Later{});
+        heap_.pop_back();
+    }
+
+    // Удаляет события, для которых pred(event) истинно
+    template <typename Pred>
+    void EraseIf(Pred&& pred) {
+        std::erase_if(heap_, [&pred](const Entry& entry) {
+            return pred(entry.event);
+        });
+        std::make_heap(heap_.begin(), heap_.end(), Later{});
+    }
+
+private:
+    struct Entry {
+        MotionEvent event;
+        std::uint64_t seq;
+    };
+
+    struct Later {
+        bool operator()(const Entry& lhs, const Entry& rhs) const noexcept {
+            return lhs.event.time != rhs.event.time ? lhs.event.time > rhs.event.time : lhs.seq > rhs.seq;
+        }
+    };
+
+    std::vector<Entry> heap_;
+    std::uint64_t next_seq_ = 0;
+};
+
+}  // namespace model
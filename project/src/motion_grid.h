@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "road_index.h"
+
+namespace model {
+
+/*
+ *  Раскладка событийной сессии по ячейкам сетки дорог карты.
+ *  Ячейка хранит лежащие в ней предметы и оставшиеся пути движущихся собак, которые её пересекают.
+ *  Поэтому при смене направления подбор предсказывается только для предметов рядом с путём,
+ *  а при появлении предмета - только для собак, чей путь проходит через его ячейку.
+ *  Пути не удаляются при смене траектории: устаревшие пропускаются и удаляются при обходе ячейки.
+ */
+class MotionGrid {
+public:
+    struct LootRef {
+        size_t id = 0;
+        double x = 0.0;
+        double y = 0.0;
+    };
+
+    struct PathRef {
+        size_t slot = 0;
+        // Версия траектории собаки, для которой записан путь
+        std::uint64_t epoch = 0;
+    };
+
+    void Reset(const RoadIndex& roads) {
+        roads_ = &roads;
+        loot_cells_.assign(roads.CellsCount(), {});
+        path_cells_.assign(roads.CellsCount(), {});
+        paths_count_ = 0;
+    }
+
+    void AddLoot(size_t id, double x, double y) {
+        loot_cells_[roads_->CellOf(x, y)].push_back(LootRef{id, x, y});
+    }
+
+    void RemoveLoot(size_t id, double x, double y) {
+        auto& cell = loot_cells_[roads_->CellOf(x, y)];
+        for (auto& loot : cell) {
+            if (loot.id == id) {
+                loot = cell.back();
+                cell.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Вызывает fn(LootRef) для предметов из ячеек, которые пересекает прямоугольник
+    template <typename Fn>
+    void ForEachLootIn(double min_x, double min_y, double max_x, double max_y, Fn&& fn) const {
+        roads_->ForEachCellIn(min_x, min_y, max_x, max_y, [&](size_t cell) {
+            for (const auto& loot : loot_cells_[cell]) {
+                fn(loot);
+            }
+        });
+    }
+
+    // Записывает путь собаки во все ячейки, которые пересекает прямоугольник вокруг него
+    void AddPath(size_t slot, std::uint64_t epoch, double min_x, double min_y, double max_x, double max_y) {
+        roads_->ForEachCellIn(min_x, min_y, max_x, max_y, [&](size_t cell) {
+            path_cells_[cell].push_back(PathRef{slot, epoch});
+            ++paths_count_;
+        });
+    }
+
+    // Вызывает fn(PathRef) для путей, проходящих через ячейку точки (x, y).
+    // Путь, для которого fn вернула false, устарел и удаляется
+    template <typename Fn>
+    void ForEachPathAt(double x, double y, Fn&& fn) {
+        auto& cell = path_cells_[roads_->CellOf(x, y)];
+        for (size_t i = 0; i < cell.size();) {
+            if (fn(cell[i])) {
+                ++i;
+                continue;
+            }
+            cell[i] = cell.back();
+            cell.pop_back();
+            --paths_count_;
+        }
+    }
+
+    // Удаляет из всех ячеек пути, для которых stale(PathRef) истинно
+    template <typename Pred>
+    void ErasePathsIf(Pred&& stale) {
+        paths_count_ = 0;
+        for (auto& cell : path_cells_) {
+            std::erase_if(cell, stale);
+            paths_count_ += cell.size();
+        }
+    }
+
+    // Число записанных путей во всех ячейках вместе с ещё не удалёнными устаревшими
+    size_t PathsCount() const noexcept {
+        return paths_count_;
+    }
+
+private:
+    const RoadIndex* roads_ = nullptr;
+    std::vector<std::vector<LootRef>> loot_cells_;
+    std::vector<std::vector<PathRef>> path_cells_;
+    size_t paths_count_ = 0;
+};
+
+}  // namespace model
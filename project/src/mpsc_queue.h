@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Неблокирующая очередь со многими писателями и одним читателем.
+ *  Писатели добавляют элементы в голову односвязного списка одной операцией compare-exchange,
+ *  а читатель забирает весь список разом и разворачивает его, восстанавливая порядок добавления.
+ *  Читатель не извлекает узлы по одному, поэтому проблема ABA не возникает.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        Free(head_.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    // Можно вызывать из любого потока
+    void Push(T value) {
+        Node* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Переносит в out все добавленные элементы в порядке добавления. Вызывается одним потоком
+    void Drain(std::vector<T>& out) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        if (!node) {
+            return;
+        }
+        // Список хранит элементы от последнего к первому
+        Node* reversed = nullptr;
+        while (node) {
+            Node* next = std::exchange(node->next, reversed);
+            reversed = std::exchange(node, next);
+        }
+        while (reversed) {
+            out.emplace_back(std::move(reversed->value));
+            delete std::exchange(reversed, reversed->next);
+        }
+    }
+
+    bool Empty() const noexcept {
+        return head_.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    static void Free(Node* node) {
+        while (node) {
+            delete std::exchange(node, node->next);
+        }
+    }
+
+    std::atomic<Node*> head_{nullptr};
+};
+
+}  // namespace util
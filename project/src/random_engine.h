@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace util {
+
+// Перемешивает 64-битное значение (шаг генератора splitmix64)
+inline std::uint64_t SplitMix64(std::uint64_t& state) noexcept {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/*
+ *  Быстрый генератор псевдослучайных чисел xoshiro256**.
+ *  Состояние занимает 32 байта и заполняется из 64-битного зерна, поэтому создание генератора
+ *  почти ничего не стоит, а одно и то же зерно всегда даёт одну и ту же последовательность.
+ *  Удовлетворяет требованиям UniformRandomBitGenerator и подходит для распределений из <random>.
+ */
+class RandomEngine {
+public:
+    using result_type = std::uint64_t;
+
+    explicit RandomEngine(std::uint64_t seed) noexcept {
+        for (auto& word : state_) {
+            word = SplitMix64(seed);
+        }
+    }
+
+    static constexpr result_type min() noexcept {
+        return 0;
+    }
+
+    static constexpr result_type max() noexcept {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() noexcept {
+        const std::uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+        const std::uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = Rotl(state_[3], 45);
+        return result;
+    }
+
+    // Равномерно распределённое число из [0, 1)
+    double NextDouble() noexcept {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // Равномерно распределённое целое из [0, bound), bound > 0. Умножение вместо деления по модулю
+    std::uint64_t NextBelow(std::uint64_t bound) noexcept {
+        return static_cast<std::uint64_t>((static_cast<unsigned __int128>((*this)()) * bound) >> 64);
+    }
+
+private:
+    static constexpr std::uint64_t Rotl(std::uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    std::uint64_t state_[4];
+};
+
+// Непредсказуемое зерно из std::random_device
+inline std::uint64_t RandomSeed() {
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+}
+
+}  // namespace util
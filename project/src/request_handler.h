@@ -1,6 +1,7 @@
 #pragma once
 #include "http_server.h"
 #include "api_request_handler.h"
+#include "state_waiters.h"
 #include "model.h"
 #include <boost/json.hpp>
 #include <string>
@@ -32,7 +33,8 @@ public:
     explicit RequestHandler(app::Application& app, fs::path path, Strand api_strand)
         : app_{app}
         , static_path_{fs::canonical(path)}
-        , api_strand_{api_strand} {}
+        , api_strand_{api_strand}
+        , state_waiters_{std::make_shared<StateWaiters>(app, api_strand.get_inner_executor())} {}
 
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
@@ -47,11 +49,24 @@ public:
             code = res.result_int();
             content_type = res.at(http::field::content_type);
             send(res);
+        } else if(auto wait = api_handler_.ParseStateWait(req)) {
+            // Ответ уйдёт после публикации нового снимка, поток запроса не ждёт его.
+            // Код ответа (200 или 401 unknownToken) станет известен только тогда,
+            // поэтому в журнал попадают код -1 и тип "null" как у отложенного ответа
+            state_waiters_->Wait(std::move(wait->token), wait->after,
+                                 [self = shared_from_this(), send, req = std::forward<decltype(req)>(req)](const app::ResponseBody& body) {
+                send(self->api_handler_.MakeStateResponse(req, body));
+            });
+        } else if(!api_handler_.NeedsStrand(req.target())) {
+            ApiResponse res = api_handler_(req);
+            code = res.result_int();
+            content_type = res.at(http::field::content_type);
+            send(res);
         } else {
             auto handle = [self = shared_from_this(), send, req = std::forward<decltype(req)>(req), &code, &content_type] {
                 //running_in_this_thread() - возвращает true, если текущий поток выполняет функцию, отправленную в strand через post, dispatch или defer
                 assert(self->api_strand_.running_in_this_thread());
-                StringResponse res = self->api_handler_(req);
+                ApiResponse res = self->api_handler_(req);
                 code = res.result_int();
                 content_type = res.at(http::field::content_type);
                 send(res);
@@ -63,6 +78,11 @@ public:
         return std::make_tuple(code, content_type);
     }
 
+    // Будит запросы, ждущие новых снимков. Вызывается после публикации снимков
+    void WakeStateWaiters() {
+        state_waiters_->WakeAll();
+    }
+
 private:
     app::Application& app_;
     fs::path    static_path_;  // Путь со статическими файлами
@@ -70,6 +90,7 @@ private:
     std::shared_ptr<app::Players>      players_;
     ApiRequestHandler api_handler_{app_}; // Обработчик REST API
     Strand api_strand_;
+    std::shared_ptr<StateWaiters> state_waiters_;
 
     // Значение заголовка Content-Type в зависимости от типа файла
     std::unordered_map<std::string_view, std::string_view> ContentTypeOfExtension 
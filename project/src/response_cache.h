@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace app {
+
+// Сериализованное тело ответа. Одно тело разделяется между всеми запросами, получившими его
+using ResponseBody = std::shared_ptr<const std::string>;
+
+// Тело ответа и номер снимка, по которому оно построено. Пустое тело означает неизвестный токен
+struct VersionedResponse {
+    ResponseBody body;
+    std::uint64_t tick = 0;
+};
+
+/*
+ *  Тело ответа, построенное для определённой версии данных.
+ *  Первый запрос новой версии строит тело, остальные получают готовое. Построение идёт под
+ *  мьютексом, поэтому одновременные запросы одной версии сериализуют данные один раз.
+ *  Запрос более старой версии, опоздавший к смене версий, строит тело без сохранения.
+ */
+class VersionedBody {
+public:
+    template <typename Build>
+    ResponseBody Get(std::uint64_t version, Build&& build) {
+        std::lock_guard lock{mutex_};
+        if(body_ && version_ == version) {
+            return body_;
+        }
+        auto body = std::make_shared<const std::string>(build());
+        if(!body_ || version_ < version) {
+            body_    = body;
+            version_ = version;
+        }
+        return body;
+    }
+
+private:
+    std::mutex mutex_;
+    std::uint64_t version_ = 0;
+    ResponseBody body_;
+};
+
+}  // namespace app
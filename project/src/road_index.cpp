@@ -0,0 +1,95 @@
+#include "road_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace model {
+
+namespace {
+// Минимальный размер ячейки сетки, чтобы короткие дороги не дробили карту на мелкие ячейки
+constexpr double MIN_CELL_SIZE = 1.0;
+// Ограничение на число ячеек по одной оси
+constexpr size_t MAX_CELLS_PER_AXIS = 1024;
+}  // namespace
+
+RoadIndex::RoadIndex(const MapGeometry& geometry) {
+    std::vector<RoadBounds> bounds;
+    bounds.reserve(geometry.RoadsCount());
+    bounds.insert(bounds.end(), geometry.horizontal.bounds.begin(), geometry.horizontal.bounds.end());
+    bounds.insert(bounds.end(), geometry.vertical.bounds.begin(), geometry.vertical.bounds.end());
+    if (bounds.empty()) {
+        return;
+    }
+
+    // Габариты всей дорожной сети
+    double min_x = bounds.front().min_x;
+    double min_y = bounds.front().min_y;
+    double max_x = bounds.front().max_x;
+    double max_y = bounds.front().max_y;
+    for (const auto& b : bounds) {
+        min_x = std::min(min_x, b.min_x);
+        min_y = std::min(min_y, b.min_y);
+        max_x = std::max(max_x, b.max_x);
+        max_y = std::max(max_y, b.max_y);
+    }
+    const double width  = max_x - min_x;
+    const double height = max_y - min_y;
+
+    // Подбираем размер ячейки так, чтобы на одну дорогу в среднем приходилась одна ячейка
+    cell_size_ = std::max(MIN_CELL_SIZE, std::sqrt(width * height / bounds.size()));
+    cell_size_ = std::max({cell_size_, width / MAX_CELLS_PER_AXIS, height / MAX_CELLS_PER_AXIS});
+    origin_x_ = min_x;
+    origin_y_ = min_y;
+    cols_ = static_cast<size_t>(width / cell_size_) + 1;
+    rows_ = static_cast<size_t>(height / cell_size_) + 1;
+
+    // Дорога попадает и в ячейки, которых касается только допуском её границ
+    constexpr double EPS = ROAD_BOUNDS_EPSILON;
+
+    // Первый проход считает число дорог в каждой ячейке, второй раскладывает их границы
+    cell_offsets_.assign(cols_ * rows_ + 1, 0);
+    for (const auto& b : bounds) {
+        for (size_t row = RowOf(b.min_y - EPS); row <= RowOf(b.max_y + EPS); ++row) {
+            for (size_t col = ColOf(b.min_x - EPS); col <= ColOf(b.max_x + EPS); ++col) {
+                ++cell_offsets_[row * cols_ + col + 1];
+            }
+        }
+    }
+    for (size_t cell = 1; cell < cell_offsets_.size(); ++cell) {
+        cell_offsets_[cell] += cell_offsets_[cell - 1];
+    }
+
+    cell_bounds_.resize(cell_offsets_.back());
+    std::vector<size_t> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (const auto& b : bounds) {
+        for (size_t row = RowOf(b.min_y - EPS); row <= RowOf(b.max_y + EPS); ++row) {
+            for (size_t col = ColOf(b.min_x - EPS); col <= ColOf(b.max_x + EPS); ++col) {
+                cell_bounds_[fill[row * cols_ + col]++] = b;
+            }
+        }
+    }
+}
+
+size_t RoadIndex::ColOf(double x) const noexcept {
+    if (x <= origin_x_) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>((x - origin_x_) / cell_size_), cols_ - 1);
+}
+
+size_t RoadIndex::RowOf(double y) const noexcept {
+    if (y <= origin_y_) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>((y - origin_y_) / cell_size_), rows_ - 1);
+}
+
+size_t RoadIndex::FindCell(double x, double y) const noexcept {
+    if (cols_ == 0) {
+        return NO_CELL;
+    }
+    // Точки вне сетки относятся к крайним ячейкам, чужие дороги отсеет проверка границ
+    return CellOf(x, y);
+}
+
+}  // namespace model
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "map_geometry.h"
+
+namespace model {
+
+/*
+ *  Пространственный индекс дорог карты - равномерная сетка.
+ *  Каждая ячейка хранит подряд границы дорог, которые её пересекают,
+ *  поэтому поиск дорог под точкой не зависит от общего числа дорог на карте.
+ */
+class RoadIndex {
+public:
+    RoadIndex() = default;
+    explicit RoadIndex(const MapGeometry& geometry);
+
+    // Вызывает fn(bounds) для каждой дороги, границы которой содержат точку (x, y)
+    template <typename Fn>
+    void ForEachRoadAt(double x, double y, Fn&& fn) const {
+        const size_t cell = FindCell(x, y);
+        if (cell == NO_CELL) {
+            return;
+        }
+        for (size_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+            const RoadBounds& bounds = cell_bounds_[i];
+            if (bounds.Contains(x, y)) {
+                fn(bounds);
+            }
+        }
+    }
+
+    // Число ячеек сетки. По номерам ячеек другие индексы раскладывают объекты, лежащие на дорогах
+    size_t CellsCount() const noexcept {
+        return cols_ * rows_;
+    }
+
+    // Номер ячейки, в которую попадает точка. Точки вне сетки относятся к крайним ячейкам
+    size_t CellOf(double x, double y) const noexcept {
+        return RowOf(y) * cols_ + ColOf(x);
+    }
+
+    // Вызывает fn(cell) для каждой ячейки, которую пересекает прямоугольник
+    template <typename Fn>
+    void ForEachCellIn(double min_x, double min_y, double max_x, double max_y, Fn&& fn) const {
+        if (cols_ == 0) {
+            return;
+        }
+        const size_t col_begin = ColOf(min_x);
+        const size_t col_end   = ColOf(max_x);
+        for (size_t row = RowOf(min_y), row_end = RowOf(max_y); row <= row_end; ++row) {
+            for (size_t col = col_begin; col <= col_end; ++col) {
+                fn(row * cols_ + col);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t NO_CELL = static_cast<size_t>(-1);
+
+    size_t FindCell(double x, double y) const noexcept;
+    // Столбец и строка сетки, в которые попадает координата, с прижатием к краям сетки
+    size_t ColOf(double x) const noexcept;
+    size_t RowOf(double y) const noexcept;
+
+    double origin_x_ = 0.0;
+    double origin_y_ = 0.0;
+    double cell_size_ = 1.0;
+    size_t cols_ = 0;
+    size_t rows_ = 0;
+
+    // Дороги ячейки cell лежат в cell_bounds_[cell_offsets_[cell], cell_offsets_[cell + 1])
+    std::vector<size_t> cell_offsets_;
+    std::vector<RoadBounds> cell_bounds_;
+};
+
+}  // namespace model
@@ -0,0 +1,54 @@
+#pragma once
+#include "response_cache.h"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <utility>
+
+namespace http_handler {
+namespace beast = boost::beast;
+namespace http  = beast::http;
+namespace net   = boost::asio;
+
+/*
+ *  Тело HTTP-ответа, которое держит разделяемое тело app::ResponseBody вместо своей копии.
+ *  Ответы на запросы одной версии данных отправляют одну и ту же строку из VersionedBody.
+ *  Тело только отправляется, поэтому reader для разбора не нужен.
+ */
+struct SharedStringBody {
+    using value_type = app::ResponseBody;
+
+    static std::uint64_t size(const value_type& body) noexcept {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, typename Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+            : body_{body} {}
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        // Всё тело отдаётся одним буфером
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            if(!body_ || body_->empty()) {
+                return boost::none;
+            }
+            return {{const_buffers_type{body_->data(), body_->size()}, false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+}  // namespace http_handler
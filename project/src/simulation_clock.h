@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace app {
+
+/*
+ *  Часы игрового цикла с фиксированным шагом.
+ *  Прошедшее время делится на шаги одинаковой длины, поэтому результат моделирования не зависит
+ *  от того, насколько вовремя сработал таймер. За один вызов выполняется не больше max_steps шагов,
+ *  чтобы перегруженный сервер не тратил всё время на догоняние.
+ */
+class SimulationClock {
+public:
+    using Duration = std::chrono::milliseconds;
+
+    struct Stats {
+        // Выполнено шагов моделирования
+        std::uint64_t steps = 0;
+        // Вызовы, в которых пришлось ограничить догоняние
+        std::uint64_t overruns = 0;
+        // Время, отброшенное при ограничении догоняния
+        Duration dropped{};
+    };
+
+    SimulationClock(Duration step, unsigned max_steps)
+        : step_{std::max(step, Duration{1})}
+        , max_steps_{std::max(max_steps, 1u)} {
+    }
+
+    // Моделирует прошедшее по таймеру время: вызывает step_fn(шаг) для каждого полного шага.
+    // Остаток меньше шага переходит к следующему вызову, а время сверх max_steps шагов отбрасывается
+    template <typename StepFn>
+    void Advance(Duration elapsed, StepFn&& step_fn) {
+        pending_ += elapsed;
+        auto steps = pending_ / step_;
+        if (steps > max_steps_) {
+            ++stats_.overruns;
+            stats_.dropped += (steps - max_steps_) * step_;
+            steps = max_steps_;
+        }
+        pending_ %= step_;
+        for (decltype(steps) i = 0; i < steps; ++i) {
+            step_fn(step_);
+            ++stats_.steps;
+        }
+    }
+
+    // Моделирует ровно elapsed, последний шаг может быть короче. Если шагов получается больше
+    // max_steps, они удлиняются, поэтому время не теряется, а работа остаётся ограниченной
+    template <typename StepFn>
+    void AdvanceExactly(Duration elapsed, StepFn&& step_fn) {
+        const Duration step = std::max(step_, (elapsed + (max_steps_ - 1) * Duration{1}) / max_steps_);
+        for (; elapsed > Duration::zero(); elapsed -= std::min(step, elapsed)) {
+            step_fn(std::min(step, elapsed));
+            ++stats_.steps;
+        }
+    }
+
+    Duration GetStep() const noexcept {
+        return step_;
+    }
+
+    const Stats& GetStats() const noexcept {
+        return stats_;
+    }
+
+private:
+    Duration step_;
+    unsigned max_steps_;
+    // Прошедшее время, ещё не вошедшее ни в один шаг
+    Duration pending_{};
+    Stats stats_;
+};
+
+}  // namespace app
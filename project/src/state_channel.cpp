@@ -0,0 +1,184 @@
+#include "state_channel.h"
+#include "api_request_handler.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/json.hpp>
+
+namespace http_handler {
+
+using namespace std::literals;
+namespace json = boost::json;
+
+std::string_view ws_target = "/api/v1/game/ws"sv;
+
+// Наибольший размер сообщения клиента, команды движения намного короче
+constexpr size_t MAX_CLIENT_MESSAGE = 1024;
+
+class StateChannel::Subscriber : public std::enable_shared_from_this<Subscriber> {
+public:
+    Subscriber(std::shared_ptr<StateChannel> channel, beast::tcp_stream&& stream, std::string token)
+        : channel_{std::move(channel)}
+        , ws_{std::move(stream)}
+        , token_{std::move(token)} {}
+
+    void Run(http::request<http::string_body>&& req) {
+        // Запрос должен жить до завершения рукопожатия
+        upgrade_request_ = std::move(req);
+        // Таймаут чтения HTTP-запроса больше не действует, за соединением следит WebSocket
+        beast::get_lowest_layer(ws_).expires_never();
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.read_message_max(MAX_CLIENT_MESSAGE);
+        ws_.text(true);
+        ws_.async_accept(upgrade_request_, beast::bind_front_handler(&Subscriber::OnAccept, shared_from_this()));
+    }
+
+    // Можно вызывать из любого потока. Оповещения, пришедшие до отправки, объединяются
+    void Notify() {
+        if(!notify_posted_.exchange(true)) {
+            net::post(ws_.get_executor(), [self = shared_from_this()] {
+                self->notify_posted_ = false;
+                self->Send();
+            });
+        }
+    }
+
+private:
+    std::shared_ptr<StateChannel> channel_;
+    websocket::stream<beast::tcp_stream> ws_;
+    std::string token_;
+    http::request<http::string_body> upgrade_request_;
+
+    std::atomic<bool> notify_posted_{false};
+    // Остальные поля используются только в strand соединения
+    bool closed_  = false;
+    bool writing_ = false;
+    // За время отправки опубликованы новые снимки
+    bool dirty_   = false;
+    // Номер последнего отправленного снимка
+    std::uint64_t tick_ = 0;
+    // Отправляемое тело, оно разделяется с другими подписчиками сессии
+    app::ResponseBody sending_;
+    beast::flat_buffer read_buffer_;
+
+    void OnAccept(beast::error_code ec) {
+        if(ec) {
+            return http_server::ReportError(ec, "websocket accept"sv);
+        }
+        channel_->Subscribe(shared_from_this());
+        Send();
+        Read();
+    }
+
+    void Send() {
+        if(closed_) {
+            return;
+        }
+        if(writing_) {
+            dirty_ = true;
+            return;
+        }
+        auto update = channel_->app_.GetStateSince(token_, tick_);
+        if(!update.body) {
+            // Игрок ушёл из игры или токен неверен
+            return Close(websocket::close_reason{websocket::close_code::policy_error, "unknownToken"});
+        }
+        if(update.tick == tick_) {
+            return;
+        }
+        tick_    = update.tick;
+        sending_ = std::move(update.body);
+        writing_ = true;
+        ws_.async_write(net::buffer(*sending_), beast::bind_front_handler(&Subscriber::OnWrite, shared_from_this()));
+    }
+
+    void OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        writing_ = false;
+        sending_.reset();
+        if(ec) {
+            closed_ = true;
+            return;
+        }
+        if(std::exchange(dirty_, false)) {
+            Send();
+        }
+    }
+
+    void Read() {
+        ws_.async_read(read_buffer_, beast::bind_front_handler(&Subscriber::OnRead, shared_from_this()));
+    }
+
+    void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        if(ec) {
+            // Клиент закрыл соединение или оно оборвалось
+            closed_ = true;
+            return;
+        }
+        const std::string message = beast::buffers_to_string(read_buffer_.data());
+        read_buffer_.consume(read_buffer_.size());
+
+        sys::error_code parse_ec;
+        json::value value = json::parse(message, parse_ec);
+        if(!parse_ec && value.is_object()) {
+            if(const auto* move = value.as_object().if_contains("move"); move && move->is_string()) {
+                std::string_view dir = move->as_string();
+                Move(std::string{dir});
+            }
+        }
+        Read();
+    }
+
+    void Move(std::string dir) {
+        auto& app = channel_->app_;
+        // Без таймера команды применяются сразу и должны выполняться в strand API
+        if(app.IsTick()) {
+            app.Move(token_, dir);
+            return;
+        }
+        net::dispatch(channel_->api_strand_, [&app, token = token_, dir = std::move(dir)] {
+            app.Move(token, dir);
+        });
+    }
+
+    void Close(websocket::close_reason reason) {
+        closed_ = true;
+        ws_.async_close(reason, [self = shared_from_this()](beast::error_code) {});
+    }
+};
+
+bool StateChannel::Upgrade(http::request<http::string_body>& req, beast::tcp_stream& stream) {
+    if(TargetPath(req.target()) != ws_target) {
+        return false;
+    }
+    // Браузер не может задать заголовки запроса WebSocket, поэтому токен передаётся и параметром
+    std::string token;
+    // Токен неверной длины остаётся пустым, и подписчик закрывает соединение с unknownToken
+    if(const auto param = QueryParam(req.target(), "token"sv)) {
+        if(param->size() == TOKEN_LENGTH) {
+            token = *param;
+        }
+    } else if(const auto bearer = BearerToken(req)) {
+        token = *bearer;
+    }
+    std::make_shared<Subscriber>(shared_from_this(), std::move(stream), std::move(token))->Run(std::move(req));
+    return true;
+}
+
+void StateChannel::Broadcast() {
+    std::lock_guard lock{mutex_};
+    std::erase_if(subscribers_, [](const std::weak_ptr<Subscriber>& weak) {
+        auto subscriber = weak.lock();
+        if(!subscriber) {
+            return true;
+        }
+        subscriber->Notify();
+        return false;
+    });
+}
+
+void StateChannel::Subscribe(std::shared_ptr<Subscriber> subscriber) {
+    std::lock_guard lock{mutex_};
+    subscribers_.emplace_back(std::move(subscriber));
+}
+
+}  // namespace http_handler
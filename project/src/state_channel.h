@@ -0,0 +1,51 @@
+#pragma once
+#include "http_server.h"
+#include "Players.h"
+
+#include <boost/asio/strand.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace http_handler {
+namespace beast     = boost::beast;
+namespace http      = beast::http;
+namespace net       = boost::asio;
+namespace websocket = beast::websocket;
+
+/*
+ *  Канал WebSocket /api/v1/game/ws?token=<токен>.
+ *  После каждой публикации снимков сервер отправляет подписчику изменения состояния с последнего
+ *  отправленного ему снимка в формате /state?since, первым сообщением - полное состояние.
+ *  Клиент присылает по тому же соединению команды движения {"move": "L"}.
+ *  Пока предыдущее сообщение не отправлено, новые снимки не отправляются: медленный клиент
+ *  получит одно сообщение с изменениями за все пропущенные тики.
+ */
+class StateChannel : public std::enable_shared_from_this<StateChannel> {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+
+    StateChannel(app::Application& app, Strand api_strand)
+        : app_{app}
+        , api_strand_{api_strand} {}
+
+    // Обработчик перехода на WebSocket для http_server::ServeHttp. Запросы к другим адресам не принимает
+    bool Upgrade(http::request<http::string_body>& req, beast::tcp_stream& stream);
+    // Оповещает подписчиков о новых снимках. Можно вызывать из любого потока
+    void Broadcast();
+
+private:
+    class Subscriber;
+
+    app::Application& app_;
+    Strand api_strand_;
+
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<Subscriber>> subscribers_;
+
+    void Subscribe(std::shared_ptr<Subscriber> subscriber);
+};
+
+}  // namespace http_handler
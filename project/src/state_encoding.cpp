@@ -0,0 +1,103 @@
+#include "state_encoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace app {
+
+namespace {
+
+// Пишет поля прямо в строку ответа без промежуточного представления
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out)
+        : out_{out} {}
+
+    void Varint(std::uint64_t value) {
+        while(value >= 0x80) {
+            out_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void U8(std::uint8_t value) {
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void I16(std::int16_t value) {
+        Fixed(static_cast<std::uint16_t>(value));
+    }
+
+    void I32(std::int32_t value) {
+        Fixed(static_cast<std::uint32_t>(value));
+    }
+
+private:
+    std::string& out_;
+
+    template <typename Unsigned>
+    void Fixed(Unsigned value) {
+        for(size_t i = 0; i < sizeof(Unsigned); ++i) {
+            out_.push_back(static_cast<char>(value & 0xFF));
+            value >>= 8;
+        }
+    }
+};
+
+// Значение в фиксированной точке, выходящие за диапазон типа значения ограничиваются
+template <typename Int>
+Int Quantize(double value, double scale) {
+    const double scaled = std::round(value * scale);
+    return static_cast<Int>(std::clamp(scaled, double(std::numeric_limits<Int>::min()),
+                                       double(std::numeric_limits<Int>::max())));
+}
+
+// Размер записей без varint-полей, по нему резервируется место в строке
+constexpr size_t DOG_FIXED_SIZE  = 4 + 4 + 2 + 2 + 1;
+constexpr size_t LOOT_FIXED_SIZE = 4 + 4;
+// Запас на varint-поля записи
+constexpr size_t RECORD_VARINTS_SIZE = 16;
+constexpr size_t BAG_ITEM_SIZE = 12;
+
+}  // namespace
+
+void EncodeStateBinary(const model::SessionSnapshot& snapshot, std::string& out) {
+    size_t size = 1 + 3 * RECORD_VARINTS_SIZE;
+    for(const auto& dog : snapshot.dogs) {
+        size += DOG_FIXED_SIZE + RECORD_VARINTS_SIZE + dog.bag.size() * BAG_ITEM_SIZE;
+    }
+    size += snapshot.loot.size() * (LOOT_FIXED_SIZE + RECORD_VARINTS_SIZE);
+    out.reserve(out.size() + size);
+
+    BinaryWriter writer{out};
+    writer.U8(STATE_BINARY_VERSION);
+    writer.Varint(snapshot.version);
+    writer.Varint(snapshot.dogs.size());
+    writer.Varint(snapshot.loot.size());
+
+    for(const auto& dog : snapshot.dogs) {
+        writer.Varint(*dog.id);
+        writer.I32(Quantize<std::int32_t>(dog.pos.x, COORD_SCALE));
+        writer.I32(Quantize<std::int32_t>(dog.pos.y, COORD_SCALE));
+        writer.I16(Quantize<std::int16_t>(dog.speed.horizont, SPEED_SCALE));
+        writer.I16(Quantize<std::int16_t>(dog.speed.vertical, SPEED_SCALE));
+        writer.U8(static_cast<std::uint8_t>(dog.dir));
+        writer.Varint(dog.score);
+        writer.Varint(dog.bag.size());
+        for(const auto& [id, type] : dog.bag) {
+            writer.Varint(id);
+            writer.Varint(type);
+        }
+    }
+
+    for(const auto& loot : snapshot.loot) {
+        writer.Varint(loot.id);
+        writer.Varint(loot.type);
+        writer.I32(Quantize<std::int32_t>(loot.pos.x, COORD_SCALE));
+        writer.I32(Quantize<std::int32_t>(loot.pos.y, COORD_SCALE));
+    }
+}
+
+}  // namespace app
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "model.h"
+
+namespace app {
+
+/*
+ *  Двоичное представление состояния сессии, тип содержимого STATE_BINARY_CONTENT_TYPE.
+ *  Целые без знака записываются как varint (по 7 бит в байте, младшие первыми), остальные поля
+ *  имеют фиксированный размер и порядок байтов от младшего к старшему.
+ *
+ *  Заголовок:     u8 версия формата, varint номер снимка, varint число собак, varint число предметов
+ *  Собака:        varint id, i32 x, i32 y, i16 скорость x, i16 скорость y, u8 направление,
+ *                 varint очки, varint число предметов в рюкзаке, затем пары varint id, varint тип
+ *  Предмет:       varint id, varint тип, i32 x, i32 y
+ *
+ *  Координаты хранятся в фиксированной точке с шагом 1 / COORD_SCALE, скорости - 1 / SPEED_SCALE.
+ *  Направление - значение model::Direction: 0 - нет, 1 - U, 2 - D, 3 - L, 4 - R.
+ */
+inline constexpr std::string_view STATE_BINARY_CONTENT_TYPE = "application/x-dog-state";
+inline constexpr std::uint8_t STATE_BINARY_VERSION = 1;
+inline constexpr double COORD_SCALE = 1000.0;
+inline constexpr double SPEED_SCALE = 256.0;
+
+// Дописывает состояние снимка в конец out
+void EncodeStateBinary(const model::SessionSnapshot& snapshot, std::string& out);
+
+}  // namespace app
@@ -0,0 +1,69 @@
+#include "state_waiters.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+
+namespace http_handler {
+
+struct StateWaiters::Waiter {
+    Waiter(Executor executor, std::string token, std::uint64_t after, Complete complete)
+        : timer{net::make_strand(executor)}
+        , token{std::move(token)}
+        , after{after}
+        , deadline{Clock::now() + MAX_WAIT}
+        , complete{std::move(complete)} {}
+
+    // Таймер и проверка состояния работают в одном strand
+    net::steady_timer timer;
+    std::string token;
+    std::uint64_t after;
+    Clock::time_point deadline;
+    Complete complete;
+};
+
+void StateWaiters::Wait(std::string token, std::uint64_t after, Complete complete) {
+    // Номер новее текущего снимка клиент мог получить, например, до перезапуска сервера.
+    // Такой запрос не ждёт, а сразу получает полное состояние
+    auto update = app_.GetStateSince(token, after);
+    if(!update.body || update.tick != after) {
+        return complete(update.body);
+    }
+    auto waiter = std::make_shared<Waiter>(executor_, std::move(token), after, std::move(complete));
+    net::dispatch(waiter->timer.get_executor(), [self = shared_from_this(), waiter] {
+        self->Check(waiter);
+    });
+}
+
+void StateWaiters::Check(std::shared_ptr<Waiter> waiter) {
+    // Запрос регистрируется до проверки, поэтому публикация после проверки отменит ожидание ниже
+    {
+        std::lock_guard lock{mutex_};
+        waiters_.emplace_back(waiter);
+    }
+    auto update = app_.GetStateSince(waiter->token, waiter->after);
+    if(!update.body || update.tick != waiter->after || Clock::now() >= waiter->deadline) {
+        return waiter->complete(update.body);
+    }
+    // Таймер срабатывает по сроку ожидания или отменяется публикацией снимков
+    waiter->timer.expires_at(waiter->deadline);
+    waiter->timer.async_wait([self = shared_from_this(), waiter](boost::system::error_code) {
+        self->Check(waiter);
+    });
+}
+
+void StateWaiters::WakeAll() {
+    std::vector<std::weak_ptr<Waiter>> waiters;
+    {
+        std::lock_guard lock{mutex_};
+        waiters.swap(waiters_);
+    }
+    for(const auto& weak : waiters) {
+        if(auto waiter = weak.lock()) {
+            net::post(waiter->timer.get_executor(), [waiter] {
+                waiter->timer.cancel();
+            });
+        }
+    }
+}
+
+}  // namespace http_handler
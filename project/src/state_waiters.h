@@ -0,0 +1,58 @@
+#pragma once
+#include "Players.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace http_handler {
+namespace net = boost::asio;
+using namespace std::literals;
+
+/*
+ *  Отложенные ответы на запросы /state?after=<tick>.
+ *  Запрос ждёт без потока на таймере, пока сессия игрока не опубликует снимок новее after,
+ *  и получает изменения с after в формате /state?since. Публикация снимков будит все ожидающие
+ *  запросы, а если за MAX_WAIT новых снимков нет, запрос получает ответ без изменений.
+ */
+class StateWaiters : public std::enable_shared_from_this<StateWaiters> {
+public:
+    // Получает тело ответа или nullptr для неизвестного токена
+    using Complete = std::function<void(const app::ResponseBody&)>;
+
+    // Меньше таймаута чтения сессии HTTP, чтобы ответ успел уйти до его срабатывания
+    static constexpr std::chrono::milliseconds MAX_WAIT = 15s;
+
+    using Executor = net::io_context::executor_type;
+
+    // Таймеры ожидающих запросов работают в своих strand исполнителя executor
+    StateWaiters(app::Application& app, Executor executor)
+        : app_{app}
+        , executor_{executor} {}
+
+    // Вызывает complete сразу, если снимок новее after уже есть или after больше номера текущего снимка,
+    // иначе после публикации нового снимка
+    void Wait(std::string token, std::uint64_t after, Complete complete);
+    // Будит ожидающие запросы. Можно вызывать из любого потока
+    void WakeAll();
+
+private:
+    struct Waiter;
+    using Clock = std::chrono::steady_clock;
+
+    app::Application& app_;
+    Executor executor_;
+
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<Waiter>> waiters_;
+
+    void Check(std::shared_ptr<Waiter> waiter);
+};
+
+}  // namespace http_handler
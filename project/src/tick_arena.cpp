@@ -0,0 +1,52 @@
+#include "tick_arena.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace app {
+
+namespace {
+// Наименьший размер буфера после первого переполнения
+constexpr size_t MIN_ARENA_SIZE = 4096;
+}  // namespace
+
+TickArena::TickArena(TickArena&& other) noexcept
+    : storage_{std::move(other.storage_)} {
+    other.resource_.reset();
+}
+
+TickArena& TickArena::operator=(TickArena&& other) noexcept {
+    resource_.reset();
+    other.resource_.reset();
+    storage_ = std::move(other.storage_);
+    return *this;
+}
+
+std::pmr::memory_resource* TickArena::Reset() {
+    // Уничтожение ресурса возвращает в кучу всё, что не поместилось в буфер
+    resource_.reset();
+    if (const size_t overflow = overflow_.TakeOverflow(); overflow > 0) {
+        storage_.resize(std::max({MIN_ARENA_SIZE, storage_.size() * 2, storage_.size() + overflow}));
+    }
+    resource_.emplace(storage_.data(), storage_.size(), &overflow_);
+    return &*resource_;
+}
+
+size_t TickArena::OverflowResource::TakeOverflow() noexcept {
+    return std::exchange(overflow_, 0);
+}
+
+void* TickArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+    overflow_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void TickArena::OverflowResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool TickArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+}  // namespace app
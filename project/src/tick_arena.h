@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+namespace app {
+
+/*
+ *  Арена временных данных одного тика.
+ *  Память раздаётся подряд из общего буфера и не освобождается по отдельности,
+ *  а целиком возвращается при сбросе арены в начале следующего тика.
+ *  Если тику не хватило буфера, недостающее берётся из кучи, а к следующему тику буфер увеличивается,
+ *  поэтому в установившемся режиме тик не обращается к куче.
+ */
+class TickArena {
+public:
+    TickArena() = default;
+    TickArena(const TickArena&) = delete;
+    TickArena& operator=(const TickArena&) = delete;
+    // Арена не перемещается, пока ей выделена память, поэтому перемещение допустимо только между тиками
+    TickArena(TickArena&& other) noexcept;
+    TickArena& operator=(TickArena&& other) noexcept;
+
+    // Освобождает всё выделенное с прошлого сброса и возвращает ресурс для нового тика.
+    // Ресурс действителен до следующего сброса
+    std::pmr::memory_resource* Reset();
+
+    size_t Capacity() const noexcept {
+        return storage_.size();
+    }
+
+private:
+    // Выделяет память из кучи и запоминает, сколько не поместилось в буфер
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        size_t TakeOverflow() noexcept;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        size_t overflow_ = 0;
+    };
+
+    std::vector<std::byte> storage_;
+    OverflowResource overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
+
+}  // namespace app
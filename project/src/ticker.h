@@ -7,6 +7,8 @@
 #include <iostream>
 #include <thread>
 #include <optional>
+#include <atomic>
+#include <cstdint>
 
 using namespace std::literals;
 namespace net = boost::asio;
@@ -17,7 +19,14 @@ public:
     using Strand = net::strand<net::io_context::executor_type>;
     using Handler = std::function<void(std::chrono::milliseconds delta)>;
 
-    // Функция handler будет вызываться внутри strand с интервалом period
+    struct Stats {
+        std::uint64_t ticks = 0;
+        // Сроки, пропущенные из-за того, что обработчик не уложился в период
+        std::uint64_t overruns = 0;
+    };
+
+    // Функция handler будет вызываться внутри strand с интервалом period.
+    // Сроки вызовов отсчитываются от момента запуска, поэтому длительность обработчика не сдвигает расписание
     Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
         : strand_{strand}
         , period_{period}
@@ -27,14 +36,19 @@ public:
     void Start() {
         net::dispatch(strand_, [self = shared_from_this()] {
             self->last_tick_ = Clock::now();
+            self->next_deadline_ = self->last_tick_ + self->period_;
             self->ScheduleTick();
         });
     }
 
+    Stats GetStats() const {
+        return Stats{ticks_.load(), overruns_.load()};
+    }
+
 private:
     void ScheduleTick() {
         assert(strand_.running_in_this_thread());
-        timer_.expires_after(period_);
+        timer_.expires_at(next_deadline_);
         timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
             self->OnTick(ec);
         });
@@ -47,11 +61,20 @@ private:
         if (!ec) {
             auto this_tick = Clock::now();
             auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-            last_tick_ = this_tick;
+            last_tick_ += delta;
             try {
                 handler_(delta);
             } catch (...) {
             }
+            ++ticks_;
+
+            // Пропущенные сроки не догоняются: их время войдёт в delta следующего вызова
+            next_deadline_ += period_;
+            if (const auto now = Clock::now(); now >= next_deadline_) {
+                const auto missed = (now - next_deadline_) / period_ + 1;
+                overruns_ += missed;
+                next_deadline_ += missed * period_;
+            }
             ScheduleTick();
         }
     }
@@ -62,5 +85,8 @@ private:
     std::chrono::milliseconds period_;
     net::steady_timer timer_{strand_};
     Handler handler_;
-    std::chrono::steady_clock::time_point last_tick_;
+    Clock::time_point last_tick_;
+    Clock::time_point next_deadline_;
+    std::atomic<std::uint64_t> ticks_{0};
+    std::atomic<std::uint64_t> overruns_{0};
 };
\ No newline at end of file
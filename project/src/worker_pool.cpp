@@ -0,0 +1,83 @@
+#include "worker_pool.h"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace app {
+
+namespace {
+// Состояние одного вызова ForEach. Задача пула может начаться уже после его завершения,
+// поэтому состояние разделяется, а fn вызывается только для ещё не выданных индексов
+struct ForEachState {
+    ForEachState(size_t count, const std::function<void(size_t)>& fn)
+        : count{count}
+        , fn{fn} {
+    }
+
+    // Обрабатывает индексы, пока они не закончатся
+    void Run() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard lock{mutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            if (done.fetch_add(1) + 1 == count) {
+                done.notify_all();
+            }
+        }
+    }
+
+    const size_t count;
+    const std::function<void(size_t)>& fn;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex;
+    std::exception_ptr error;
+};
+}  // namespace
+
+WorkerPool::WorkerPool(unsigned threads)
+    : threads_{threads}
+    , pool_{std::max(1u, threads)} {
+}
+
+WorkerPool::~WorkerPool() {
+    pool_.join();
+}
+
+void WorkerPool::ForEach(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    auto state = std::make_shared<ForEachState>(count, fn);
+    const size_t helpers = std::min<size_t>(threads_, count - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        boost::asio::post(pool_, [state] {
+            state->Run();
+        });
+    }
+    state->Run();
+
+    for (size_t done = state->done.load(); done < count; done = state->done.load()) {
+        state->done.wait(done);
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+unsigned WorkerPool::ThreadsCount() const noexcept {
+    return threads_;
+}
+
+}  // namespace app
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <boost/asio/thread_pool.hpp>
+
+#include <cstddef>
+#include <functional>
+
+namespace app {
+
+/*
+ *  Пул потоков для параллельной обработки независимых частей игрового цикла.
+ *  ForEach раздаёт индексы через общий счётчик: освободившийся поток сам берёт следующий индекс,
+ *  поэтому тяжёлые задачи не задерживают лёгкие. Вызывающий поток тоже обрабатывает индексы,
+ *  поэтому ForEach завершается, даже если все потоки пула заняты.
+ */
+class WorkerPool {
+public:
+    // threads - число потоков пула, не считая вызывающего ForEach
+    explicit WorkerPool(unsigned threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Вызывает fn(i) для каждого i из [0, count) и возвращает управление, когда все вызовы завершены.
+    // Первое выброшенное fn исключение передаётся вызывающему после завершения остальных вызовов
+    void ForEach(size_t count, const std::function<void(size_t)>& fn);
+
+    unsigned ThreadsCount() const noexcept;
+
+private:
+    unsigned threads_;
+    boost::asio::thread_pool pool_;
+};
+
+}  // namespace app
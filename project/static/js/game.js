@@ -164,7 +164,10 @@ class GameState {
     this.lostObjects = {};
     this.disappearingLoot = {};
     this.player_elems = {};
+    this.stateSocket = undefined;
+    this.pushedState = {players: {}, lostObjects: {}};
 
+    this._openStateSocket();
     this._updateState(function() {
       self.stateLoaded = true;
       self._startGame();
@@ -183,7 +186,9 @@ class GameState {
     if (!this.started)
       return false;
 
-    if ((this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
+    // Пока открыт канал WebSocket, сервер сам присылает состояние после каждого тика
+    const pushed = this.stateSocket !== undefined && this.stateSocket.readyState === WebSocket.OPEN;
+    if (!pushed && (this.ticks % this.posUpdateInterval == 0 || this.requestInstantUpdate) && !this.updateInProgress) {
       this.requestInstantUpdate = false;
       this._updateState(function() {
         self._applyDesiredState();
@@ -212,6 +217,11 @@ class GameState {
 
   _pressKey(keys, then) {
     const self = this;
+    if (this.stateSocket !== undefined && this.stateSocket.readyState === WebSocket.OPEN) {
+      this.stateSocket.send(JSON.stringify({move: keys}));
+      then();
+      return;
+    }
     $.post({
       url: '/api/v1/game/player/action',
       dataType: 'json',
@@ -409,6 +419,50 @@ class GameState {
     return abandonedLoot;
   }
 
+  _openStateSocket() {
+    if (typeof WebSocket === 'undefined')
+      return;
+
+    const self = this;
+    const protocol = location.protocol === 'https:' ? 'wss://' : 'ws://';
+    const socket = new WebSocket(protocol + location.host + '/api/v1/game/ws?token=' + Cookies.get('authToken'));
+    socket.onmessage = function(event) {
+      self._applyPushedState(JSON.parse(event.data));
+    };
+    socket.onclose = function(event) {
+      self.stateSocket = undefined;
+      // 1008 - токен больше не действует, остальные случаи обслуживаются опросом
+      if (event.code == 1008)
+        goToRecords();
+    };
+    this.stateSocket = socket;
+  }
+
+  // Сообщение канала содержит полное состояние или изменения с предыдущего сообщения
+  _applyPushedState(x) {
+    const state = this.pushedState;
+    if (x.full) {
+      state.players = x.players;
+      state.lostObjects = x.lostObjects;
+    } else {
+      Object.assign(state.players, x.players);
+      Object.assign(state.lostObjects, x.lostObjects);
+      for (const id of x.removedPlayers)
+        delete state.players[id];
+      for (const id of x.removedLostObjects)
+        delete state.lostObjects[id];
+    }
+
+    this.desiredState = {players: Object.assign({}, state.players), lostObjects: Object.assign({}, state.lostObjects)};
+    this.stateTime = performance.now();
+    if (this.started) {
+      this._applyDesiredState();
+    } else {
+      this.stateLoaded = true;
+      this._startGame();
+    }
+  }
+
   _updateState(then) {
     let self = this;
     $.get({
@@ -0,0 +1,59 @@
+#include <cmath>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/alias_table.h"
+#include "../src/random_engine.h"
+
+SCENARIO("Alias table sampling") {
+    using util::AliasTable;
+    util::RandomEngine random{42};
+
+    GIVEN("weights of different size") {
+        const std::vector<double> weights{1.0, 0.0, 3.0, 6.0};
+        AliasTable table{weights};
+        REQUIRE(table.Size() == weights.size());
+
+        WHEN("many indices are sampled") {
+            constexpr int SAMPLES = 200000;
+            std::vector<int> hits(weights.size());
+            for (int i = 0; i < SAMPLES; ++i) {
+                ++hits[table.Sample(random)];
+            }
+
+            THEN("frequencies are proportional to the weights") {
+                CHECK(hits[1] == 0);
+                for (size_t i = 0; i < weights.size(); ++i) {
+                    INFO("index: " << i);
+                    CHECK(std::abs(hits[i] / double(SAMPLES) - weights[i] / 10.0) < 0.01);
+                }
+            }
+        }
+    }
+
+    GIVEN("only zero weights") {
+        AliasTable table{std::vector<double>(3, 0.0)};
+
+        THEN("every index can be sampled") {
+            std::vector<int> hits(3);
+            for (int i = 0; i < 3000; ++i) {
+                ++hits[table.Sample(random)];
+            }
+            for (int count : hits) {
+                CHECK(count > 0);
+            }
+        }
+    }
+
+    GIVEN("a fixed seed") {
+        THEN("the sequence of samples is reproduced") {
+            AliasTable table{std::vector<double>{2.0, 1.0, 1.0}};
+            util::RandomEngine first{7};
+            util::RandomEngine second{7};
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(table.Sample(first) == table.Sample(second));
+            }
+        }
+    }
+}
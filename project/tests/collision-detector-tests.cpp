@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <functional>
+#include <random>
 #include <sstream>
 
 #include <catch2/catch_test_macros.hpp>
@@ -79,6 +80,30 @@ private:
     std::vector<collision_detector::Gatherer> gatherers_;
 };
 
+// Полный перебор всех пар собиратель-предмет
+std::vector<collision_detector::GatheringEvent> FindGatherEventsBruteForce(
+    const std::vector<collision_detector::Item>& items,
+    const std::vector<collision_detector::Gatherer>& gatherers) {
+    std::vector<collision_detector::GatheringEvent> events;
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        const auto& gatherer = gatherers[g];
+        if (gatherer.start_pos == gatherer.end_pos) {
+            continue;
+        }
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto result = collision_detector::TryCollectPoint(gatherer.start_pos, gatherer.end_pos,
+                                                              items[i].position);
+            if (result.IsCollected(gatherer.width + items[i].width)) {
+                events.push_back({i, g, result.sq_distance, result.proj_ratio});
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const auto& l, const auto& r) {
+        return std::tie(l.time, l.gatherer_id, l.item_id) < std::tie(r.time, r.gatherer_id, r.item_id);
+    });
+    return events;
+}
+
 class CompareEvents {
 public:
     bool operator()(const collision_detector::GatheringEvent& l,
@@ -181,4 +206,99 @@ SCENARIO("Collision detection") {
             CHECK(events.empty());
         }
     }
-}
\ No newline at end of file
+    WHEN("many items are scattered over a large area") {
+        std::mt19937 gen{42};
+        std::uniform_real_distribution<double> coord{-100., 100.};
+        std::uniform_real_distribution<double> step{-3., 3.};
+        std::vector<collision_detector::Item> items;
+        for (int i = 0; i < 500; ++i) {
+            items.push_back({{coord(gen), coord(gen)}, i % 2 == 0 ? 0. : 0.25});
+        }
+        std::vector<collision_detector::Gatherer> gatherers;
+        for (int g = 0; g < 200; ++g) {
+            geom::Point2D start{coord(gen), coord(gen)};
+            gatherers.push_back({start, {start.x + step(gen), start.y + step(gen)}, 0.6});
+        }
+        auto expected = FindGatherEventsBruteForce(items, gatherers);
+
+        THEN("broad phase finds the same events as the full search") {
+            auto events = collision_detector::FindGatherEvents(VectorItemGathererProvider{items, gatherers});
+            std::sort(events.begin(), events.end(), [](const auto& l, const auto& r) {
+                return std::tie(l.time, l.gatherer_id, l.item_id) < std::tie(r.time, r.gatherer_id, r.item_id);
+            });
+            CHECK(!expected.empty());
+            CHECK_THAT(events, EqualsRange(expected, CompareEvents()));
+        }
+        THEN("prebuilt item index gives the same events") {
+            auto events = collision_detector::FindGatherEvents(collision_detector::ItemIndex{items}, gatherers);
+            std::sort(events.begin(), events.end(), [](const auto& l, const auto& r) {
+                return std::tie(l.time, l.gatherer_id, l.item_id) < std::tie(r.time, r.gatherer_id, r.item_id);
+            });
+            CHECK_THAT(events, EqualsRange(expected, CompareEvents()));
+        }
+        THEN("span overload fills a reused buffer with the same events") {
+            std::vector<collision_detector::GatheringEvent> events{{1, 2, 3., 4.}};
+            collision_detector::GatherScratch scratch;
+            collision_detector::FindGatherEvents(std::span{items}.first(10), gatherers, events, scratch);
+            collision_detector::FindGatherEvents(items, gatherers, events, scratch);
+            std::sort(events.begin(), events.end(), [](const auto& l, const auto& r) {
+                return std::tie(l.time, l.gatherer_id, l.item_id) < std::tie(r.time, r.gatherer_id, r.item_id);
+            });
+            CHECK_THAT(events, EqualsRange(expected, CompareEvents()));
+        }
+    }
+}
+
+SCENARIO("Batched point collection") {
+    WHEN("points lie along the way of gatherer") {
+        std::vector<double> xs{9, 8, 7, 6, 5, 4, 3, 2, 1, 0, -1};
+        std::vector<double> ys{0.27, 0.24, 0.21, 0.18, 0.15, 0.12, 0.09, 0.06, 0.03, 0.0, 0.0};
+        std::vector<double> widths(xs.size(), .1);
+        std::vector<collision_detector::CollectedPoint> collected;
+        collision_detector::TryCollectPoints({0, 0}, {10, 0}, 0.1, xs, ys, widths, collected);
+
+        THEN("the same points are collected as one by one") {
+            REQUIRE(collected.size() == 7);
+            for (size_t i = 0; i < collected.size(); ++i) {
+                CHECK(collected[i].index == i + 3);
+                CHECK(std::abs(collected[i].result.proj_ratio - (0.6 - 0.1 * i)) < 1e-10);
+                CHECK(std::abs(collected[i].result.sq_distance - 0.03 * (6 - i) * 0.03 * (6 - i)) < 1e-10);
+            }
+        }
+    }
+    WHEN("many points are checked against random segments") {
+        std::mt19937 gen{7};
+        std::uniform_real_distribution<double> coord{-10., 10.};
+        std::uniform_real_distribution<double> width{0., 1.};
+        std::vector<double> xs, ys, widths;
+        for (int i = 0; i < 101; ++i) {
+            xs.push_back(coord(gen));
+            ys.push_back(coord(gen));
+            widths.push_back(width(gen));
+        }
+
+        THEN("batch results match TryCollectPoint") {
+            for (int s = 0; s < 50; ++s) {
+                geom::Point2D a{coord(gen), coord(gen)};
+                geom::Point2D b{coord(gen), coord(gen)};
+                const double gatherer_width = width(gen);
+                std::vector<collision_detector::CollectedPoint> collected;
+                collision_detector::TryCollectPoints(a, b, gatherer_width, xs, ys, widths, collected);
+
+                std::vector<collision_detector::CollectedPoint> expected;
+                for (size_t i = 0; i < xs.size(); ++i) {
+                    auto result = collision_detector::TryCollectPoint(a, b, {xs[i], ys[i]});
+                    if (result.IsCollected(gatherer_width + widths[i])) {
+                        expected.push_back({i, result});
+                    }
+                }
+                REQUIRE(collected.size() == expected.size());
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    CHECK(collected[i].index == expected[i].index);
+                    CHECK(std::abs(collected[i].result.sq_distance - expected[i].result.sq_distance) < 1e-10);
+                    CHECK(std::abs(collected[i].result.proj_ratio - expected[i].result.proj_ratio) < 1e-10);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,232 @@
+#include <cmath>
+#include <memory>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "test_game_fixture.h"
+
+using namespace std::literals;
+using Catch::Matchers::WithinAbs;
+using test_game::MakeGridMap;
+using test_game::MakeMap;
+using test_game::NullUseCases;
+
+namespace {
+// Позиции собак после игры одной и той же сессии с одинаковыми командами
+std::vector<model::Coordinate> Play(bool event_driven) {
+    auto loot_generator = std::make_shared<loot_gen::LootGenerator>(500ms, 0.5);
+    model::Game game{loot_generator};
+    game.SetDogRetirementTime(1e6);
+    game.AddMap(MakeGridMap());
+    auto session = std::make_shared<model::GameSession>(model::GameSession::Id{0}, game.FindMap(model::Map::Id{"map"}),
+                                                        42, *loot_generator);
+    if (event_driven) {
+        session->SetEventDriven(game.GetDogRetirementTime());
+    }
+    game.AddSession(session);
+
+    NullUseCases use_cases;
+    app::Application app{game, std::make_shared<app::PlayerTokens>(), std::make_shared<app::Players>(),
+                         true, true, use_cases};
+
+    constexpr size_t DOGS = 50;
+    std::vector<std::shared_ptr<model::Dog>> dogs;
+    for (size_t i = 0; i < DOGS; ++i) {
+        dogs.emplace_back(std::make_shared<model::Dog>(model::Dog::Id{i}, "dog"s));
+        game.ConnectToSession(model::Map::Id{"map"}, dogs.back(), true);
+    }
+
+    util::RandomEngine random{7};
+    for (int tick = 0; tick < 400; ++tick) {
+        for (int i = 0; i < 3; ++i) {
+            session->SetDogDir(*dogs[random.NextBelow(DOGS)], static_cast<model::Direction>(random.NextBelow(5)));
+        }
+        app.Tick(100);
+    }
+
+    std::vector<model::Coordinate> positions;
+    for (const auto& dog : dogs) {
+        positions.emplace_back(session->GetDogPos(*dog));
+    }
+    return positions;
+}
+}  // namespace
+
+SCENARIO("Stop point of a moving dog") {
+    GIVEN("a road continued by another one through a crossing") {
+        const model::Map map = MakeMap({
+            model::Road{model::Road::HORIZONTAL, {0, 0}, 10},
+            model::Road{model::Road::VERTICAL, {10, -5}, 5},
+            model::Road{model::Road::HORIZONTAL, {10, 0}, 20},
+        });
+        const auto& roads = map.GetRoadIndex();
+
+        THEN("a dog goes through the crossing and stops at the far end plus half the road width") {
+            const auto stop = model::FindStopPoint(roads, 1.0, 0.0, 1.0, 0.0);
+            CHECK_THAT(stop.x, WithinAbs(20.4, 1e-9));
+            CHECK_THAT(stop.y, WithinAbs(0.0, 1e-9));
+        }
+        THEN("the crossing road is followed to its own end") {
+            const auto stop = model::FindStopPoint(roads, 10.0, 0.0, 0.0, -1.0);
+            CHECK_THAT(stop.x, WithinAbs(10.0, 1e-9));
+            CHECK_THAT(stop.y, WithinAbs(-5.4, 1e-9));
+        }
+        THEN("across the road a dog stops at its edge") {
+            const auto stop = model::FindStopPoint(roads, 5.0, 0.0, 0.0, 1.0);
+            CHECK_THAT(stop.x, WithinAbs(5.0, 1e-9));
+            CHECK_THAT(stop.y, WithinAbs(0.4, 1e-9));
+        }
+        THEN("a dog at rest stays in place") {
+            const auto stop = model::FindStopPoint(roads, 5.0, 0.0, 0.0, 0.0);
+            CHECK(stop.x == 5.0);
+            CHECK(stop.y == 0.0);
+        }
+    }
+}
+
+SCENARIO("Predicted events of a trajectory that has changed") {
+    auto loot_generator = std::make_shared<loot_gen::LootGenerator>(1h, 0.0);
+    model::Game game{loot_generator};
+    game.AddMap(MakeMap({model::Road{model::Road::HORIZONTAL, {0, 0}, 10}}));
+    constexpr double RETIREMENT_TIME = 5.0;
+    auto session = std::make_shared<model::GameSession>(model::GameSession::Id{0}, game.FindMap(model::Map::Id{"map"}),
+                                                        42, *loot_generator);
+    session->SetEventDriven(RETIREMENT_TIME);
+    const auto& states = session->GetDogStates();
+    const auto is_retiring = [&](const model::Dog& dog) {
+        return states.stop_time[dog.GetSlot()] >= RETIREMENT_TIME;
+    };
+
+    // Собака без команд уходит из игры через RETIREMENT_TIME секунд
+    auto dog = std::make_shared<model::Dog>(model::Dog::Id{0}, "dog"s);
+    session->AddDog(dog, false);
+
+    GIVEN("a dog that starts moving before its idle timeout") {
+        REQUIRE_FALSE(session->NextGatherEvent(3000));
+        session->SetDogDir(*dog, model::Direction::RIGHT);
+
+        WHEN("the old timeout passes") {
+            REQUIRE_FALSE(session->NextGatherEvent(6000));
+
+            THEN("the stale retirement event is skipped") {
+                CHECK_FALSE(is_retiring(*dog));
+            }
+            THEN("the dog stops at the end of the road") {
+                CHECK_THAT(session->GetDogPos(*dog).x, WithinAbs(3.0, 1e-9));
+                REQUIRE_FALSE(session->NextGatherEvent(20000));
+                CHECK_THAT(session->GetDogPos(*dog).x, WithinAbs(10.4, 1e-9));
+                CHECK(session->GetDogSpeed(*dog).horizont == 0.0);
+            }
+        }
+        WHEN("it stays after stopping") {
+            // Собака доходит до конца дороги через 10.4 секунды после старта и простаивает RETIREMENT_TIME
+            REQUIRE_FALSE(session->NextGatherEvent(3000 + 10400 + 5000 + 1));
+
+            THEN("the new retirement event fires") {
+                CHECK(is_retiring(*dog));
+            }
+        }
+    }
+
+    GIVEN("an idle dog removed while a moving dog takes its slot") {
+        auto mover = std::make_shared<model::Dog>(model::Dog::Id{1}, "mover"s);
+        session->AddDog(mover, false);
+        session->SetDogDir(*mover, model::Direction::RIGHT);
+        REQUIRE(mover->GetSlot() == 1);
+
+        session->DeleteDog(dog);
+        REQUIRE(mover->GetSlot() == 0);
+
+        WHEN("the removed dog's timeout passes") {
+            REQUIRE_FALSE(session->NextGatherEvent(6000));
+
+            THEN("its events do not affect the dog in its slot") {
+                CHECK_FALSE(is_retiring(*mover));
+                CHECK_THAT(session->GetDogPos(*mover).x, WithinAbs(6.0, 1e-9));
+            }
+        }
+    }
+
+    GIVEN("a dog that changes direction many times") {
+        session->SetDogDir(*dog, model::Direction::RIGHT);
+        const size_t pending = session->PendingMotionEvents();
+        for (int i = 0; i < 1000; ++i) {
+            session->SetDogDir(*dog, i % 2 ? model::Direction::RIGHT : model::Direction::LEFT);
+        }
+
+        THEN("stale events are purged from the queue") {
+            CHECK(session->PendingMotionEvents() <= pending + 3 * 8);
+        }
+    }
+}
+
+SCENARIO("Loot and paths by cells of the road grid") {
+    GIVEN("a long road split into several cells") {
+        model::Map map = MakeMap({
+            model::Road{model::Road::HORIZONTAL, {0, 0}, 100},
+            model::Road{model::Road::HORIZONTAL, {0, 100}, 100},
+            model::Road{model::Road::VERTICAL, {0, 0}, 100},
+            model::Road{model::Road::VERTICAL, {100, 0}, 100},
+        });
+        model::MotionGrid grid;
+        grid.Reset(map.GetRoadIndex());
+        REQUIRE(map.GetRoadIndex().CellsCount() > 1);
+
+        grid.AddLoot(1, 10.0, 0.0);
+        grid.AddLoot(2, 90.0, 100.0);
+
+        THEN("only loot near the queried path is visited") {
+            std::vector<size_t> visited;
+            grid.ForEachLootIn(0.0, -0.6, 20.0, 0.6, [&](const model::MotionGrid::LootRef& loot) {
+                visited.push_back(loot.id);
+            });
+            CHECK(visited == std::vector<size_t>{1});
+        }
+        THEN("removed loot is not visited") {
+            grid.RemoveLoot(1, 10.0, 0.0);
+            size_t visited = 0;
+            grid.ForEachLootIn(0.0, -0.6, 20.0, 0.6, [&](const model::MotionGrid::LootRef&) {
+                ++visited;
+            });
+            CHECK(visited == 0);
+        }
+
+        WHEN("paths are recorded along the road") {
+            grid.AddPath(0, 1, 0.0, -0.6, 100.0, 0.6);
+            grid.AddPath(1, 2, 0.0, -0.6, 100.0, 0.6);
+            const size_t recorded = grid.PathsCount();
+
+            THEN("a path is found at every point it crosses and stale paths are dropped") {
+                std::vector<size_t> slots;
+                grid.ForEachPathAt(95.0, 0.0, [&](const model::MotionGrid::PathRef& path) {
+                    slots.push_back(path.slot);
+                    return path.epoch != 1;
+                });
+                CHECK(slots.size() == 2);
+                CHECK(grid.PathsCount() == recorded - 1);
+
+                grid.ErasePathsIf([](const model::MotionGrid::PathRef& path) {
+                    return path.epoch == 1;
+                });
+                CHECK(grid.PathsCount() == recorded / 2);
+            }
+        }
+    }
+}
+
+SCENARIO("Event-driven and tick simulation") {
+    GIVEN("a seeded session played with the same commands in both modes") {
+        const auto by_ticks  = Play(false);
+        const auto by_events = Play(true);
+
+        THEN("dogs end up in the same positions") {
+            REQUIRE(by_ticks.size() == by_events.size());
+            for (size_t i = 0; i < by_ticks.size(); ++i) {
+                INFO("dog: " << i);
+                CHECK_THAT(by_events[i].x, WithinAbs(by_ticks[i].x, 1e-6));
+                CHECK_THAT(by_events[i].y, WithinAbs(by_ticks[i].y, 1e-6));
+            }
+        }
+    }
+}
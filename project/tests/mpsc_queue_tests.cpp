@@ -0,0 +1,67 @@
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/mpsc_queue.h"
+
+SCENARIO("Multi-producer single-consumer queue") {
+    struct Item {
+        int producer;
+        int index;
+    };
+
+    GIVEN("an empty queue") {
+        util::MpscQueue<Item> queue;
+        REQUIRE(queue.Empty());
+
+        WHEN("one thread pushes items") {
+            for (int i = 0; i < 5; ++i) {
+                queue.Push({0, i});
+            }
+
+            THEN("they are drained in push order") {
+                std::vector<Item> out;
+                queue.Drain(out);
+                REQUIRE(out.size() == 5);
+                for (int i = 0; i < 5; ++i) {
+                    CHECK(out[i].index == i);
+                }
+                CHECK(queue.Empty());
+            }
+        }
+
+        WHEN("several threads push while the consumer drains") {
+            constexpr int PRODUCERS = 4;
+            constexpr int ITEMS_PER_PRODUCER = 20000;
+
+            std::vector<Item> out;
+            {
+                std::vector<std::jthread> producers;
+                for (int p = 0; p < PRODUCERS; ++p) {
+                    producers.emplace_back([&queue, p] {
+                        for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                            queue.Push({p, i});
+                        }
+                    });
+                }
+                // Читатель забирает элементы, пока писатели ещё работают
+                while (out.size() < PRODUCERS * ITEMS_PER_PRODUCER / 2) {
+                    queue.Drain(out);
+                }
+            }
+            queue.Drain(out);
+
+            THEN("nothing is lost and each producer's items keep their order") {
+                REQUIRE(out.size() == PRODUCERS * ITEMS_PER_PRODUCER);
+                std::vector<int> next(PRODUCERS, 0);
+                for (const Item& item : out) {
+                    INFO("producer: " << item.producer);
+                    REQUIRE(item.index == next[item.producer]);
+                    ++next[item.producer];
+                }
+                CHECK(queue.Empty());
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <memory>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_game_fixture.h"
+
+using namespace std::literals;
+using test_game::MakeGridMap;
+using test_game::NullUseCases;
+
+namespace {
+// Играет одну и ту же сессию и возвращает её итоговый снимок с собаками и предметами, упорядоченными по id
+model::SessionSnapshot Play(std::shared_ptr<app::WorkerPool> workers) {
+    auto loot_generator = std::make_shared<loot_gen::LootGenerator>(500ms, 0.5);
+    model::Game game{loot_generator};
+    game.SetDogRetirementTime(1e6);
+    game.AddMap(MakeGridMap());
+    // Номер и зерно сессии задаются явно, поэтому обе игры получают одинаковые случайные числа
+    auto session = std::make_shared<model::GameSession>(model::GameSession::Id{0}, game.FindMap(model::Map::Id{"map"}),
+                                                        42, *loot_generator);
+    game.AddSession(session);
+
+    NullUseCases use_cases;
+    app::Application app{game, std::make_shared<app::PlayerTokens>(), std::make_shared<app::Players>(),
+                         true, true, use_cases, std::move(workers)};
+
+    // Собак достаточно, чтобы с пулом сессия делилась на несколько полос
+    constexpr size_t DOGS = 1200;
+    std::vector<std::shared_ptr<model::Dog>> dogs;
+    for (size_t i = 0; i < DOGS; ++i) {
+        dogs.emplace_back(std::make_shared<model::Dog>(model::Dog::Id{i}, "dog"s));
+        game.ConnectToSession(model::Map::Id{"map"}, dogs.back(), true);
+    }
+
+    util::RandomEngine random{7};
+    for (int tick = 0; tick < 300; ++tick) {
+        for (int i = 0; i < 20; ++i) {
+            session->SetDogDir(*dogs[random.NextBelow(DOGS)], static_cast<model::Direction>(random.NextBelow(5)));
+        }
+        app.Tick(50);
+    }
+
+    model::SessionSnapshot result = *session->GetSnapshot();
+    std::sort(result.dogs.begin(), result.dogs.end(), [](const auto& l, const auto& r) {
+        return *l.id < *r.id;
+    });
+    std::sort(result.loot.begin(), result.loot.end(), [](const auto& l, const auto& r) {
+        return l.id < r.id;
+    });
+    return result;
+}
+}  // namespace
+
+SCENARIO("Session tick with a worker pool") {
+    GIVEN("a seeded session played with the same commands") {
+        const model::SessionSnapshot sequential = Play(nullptr);
+        const model::SessionSnapshot parallel   = Play(std::make_shared<app::WorkerPool>(3));
+
+        THEN("dogs end up in the same positions with the same bags and scores") {
+            REQUIRE(sequential.dogs.size() == parallel.dogs.size());
+            size_t score = 0;
+            for (size_t i = 0; i < sequential.dogs.size(); ++i) {
+                INFO("dog: " << *sequential.dogs[i].id);
+                CHECK(sequential.dogs[i] == parallel.dogs[i]);
+                score += sequential.dogs[i].score;
+            }
+            CHECK(score > 0);
+        }
+
+        THEN("the same lost objects remain on the map") {
+            REQUIRE(sequential.loot.size() == parallel.loot.size());
+            for (size_t i = 0; i < sequential.loot.size(); ++i) {
+                CHECK(sequential.loot[i].id == parallel.loot[i].id);
+                CHECK(sequential.loot[i].pos == parallel.loot[i].pos);
+                CHECK(sequential.loot[i].type == parallel.loot[i].type);
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include <memory>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "test_game_fixture.h"
+
+using namespace std::literals;
+using Catch::Matchers::WithinAbs;
+using test_game::MakeMap;
+using test_game::NullUseCases;
+
+namespace {
+// Сессия с одной собакой в начале дороги. Предметы на карте не появляются
+struct Fixture {
+    std::shared_ptr<loot_gen::LootGenerator> loot_generator = std::make_shared<loot_gen::LootGenerator>(1h, 0.0);
+    model::Game game{loot_generator};
+    std::shared_ptr<model::GameSession> session;
+    std::shared_ptr<model::Dog> dog = std::make_shared<model::Dog>(model::Dog::Id{0}, "dog"s);
+    NullUseCases use_cases;
+    app::Application app{game, std::make_shared<app::PlayerTokens>(), std::make_shared<app::Players>(),
+                         true, true, use_cases};
+    size_t notifications = 0;
+
+    explicit Fixture(bool event_driven) {
+        game.SetDogRetirementTime(1e6);
+        game.AddMap(MakeMap({model::Road{model::Road::HORIZONTAL, {0, 0}, 10}}));
+        session = std::make_shared<model::GameSession>(model::GameSession::Id{0}, game.FindMap(model::Map::Id{"map"}),
+                                                       42, *loot_generator);
+        if (event_driven) {
+            session->SetEventDriven(game.GetDogRetirementTime());
+        }
+        game.AddSession(session);
+        session->AddDog(dog, false);
+        app.SetPublishListener([this] {
+            ++notifications;
+        });
+    }
+
+    std::uint64_t Version() const {
+        return session->GetSnapshot()->version;
+    }
+};
+}  // namespace
+
+SCENARIO("Publishing snapshots of a tick session") {
+    Fixture fixture{false};
+    auto& app = fixture.app;
+    fixture.app.Tick(100);
+    REQUIRE(fixture.notifications == 1);
+    const std::uint64_t joined = fixture.Version();
+
+    GIVEN("a dog standing still") {
+        WHEN("ticks pass") {
+            app.Tick(100);
+            app.Tick(100);
+
+            THEN("the snapshot version stays and subscribers are not notified") {
+                CHECK(fixture.Version() == joined);
+                CHECK(fixture.notifications == 1);
+            }
+        }
+    }
+
+    GIVEN("a dog running to the end of the road") {
+        fixture.session->SetDogDir(*fixture.dog, model::Direction::RIGHT);
+
+        THEN("every tick while it moves is published") {
+            app.Tick(5000);
+            CHECK(fixture.Version() == joined + 1);
+            CHECK_THAT(fixture.session->GetSnapshot()->dogs[0].pos.x, WithinAbs(5.0, 1e-9));
+            app.Tick(6000);
+            CHECK(fixture.Version() == joined + 2);
+
+            AND_THEN("the tick that stops the dog is the last one published") {
+                app.Tick(100);
+                CHECK(fixture.Version() == joined + 3);
+                CHECK(fixture.session->GetSnapshot()->dogs[0].speed.horizont == 0.0);
+                app.Tick(100);
+                CHECK(fixture.Version() == joined + 3);
+                CHECK(fixture.notifications == 4);
+            }
+        }
+    }
+}
+
+SCENARIO("Publishing snapshots of an event-driven session") {
+    Fixture fixture{true};
+    auto& app = fixture.app;
+    fixture.app.Tick(100);
+    const std::uint64_t joined = fixture.Version();
+
+    GIVEN("a dog standing still") {
+        THEN("ticks publish nothing") {
+            app.Tick(100);
+            CHECK(fixture.Version() == joined);
+            CHECK(fixture.notifications == 1);
+        }
+    }
+
+    GIVEN("a moving dog") {
+        fixture.session->SetDogDir(*fixture.dog, model::Direction::RIGHT);
+        app.Tick(3000);
+        const std::uint64_t moved = fixture.Version();
+        REQUIRE(moved == joined + 1);
+
+        WHEN("time passes without new commands") {
+            app.Tick(2000);
+
+            THEN("the snapshot holds the position at the end of the tick") {
+                CHECK(fixture.Version() == moved + 1);
+                CHECK_THAT(fixture.session->GetSnapshot()->dogs[0].pos.x, WithinAbs(5.0, 1e-9));
+            }
+            THEN("the previous snapshot keeps its own position") {
+                CHECK_THAT(fixture.session->GetSnapshot(moved)->dogs[0].pos.x, WithinAbs(3.0, 1e-9));
+            }
+        }
+
+        WHEN("the dog stops at the end of the road") {
+            app.Tick(10000);
+            const std::uint64_t stopped = fixture.Version();
+            app.Tick(100);
+
+            THEN("the stop is published once") {
+                CHECK(stopped == moved + 1);
+                CHECK(fixture.Version() == stopped);
+                const auto snapshot = fixture.session->GetSnapshot();
+                CHECK_THAT(snapshot->dogs[0].pos.x, WithinAbs(10.4, 1e-9));
+                CHECK(snapshot->dogs[0].speed.horizont == 0.0);
+            }
+        }
+    }
+}
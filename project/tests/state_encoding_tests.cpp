@@ -0,0 +1,169 @@
+#include <cstdint>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/api_request_handler.h"
+#include "../src/state_encoding.h"
+
+namespace {
+
+// Последовательно читает поля двоичного представления
+class Reader {
+public:
+    explicit Reader(const std::string& data)
+        : data_{data} {}
+
+    std::uint64_t Varint() {
+        std::uint64_t value = 0;
+        for(unsigned shift = 0;; shift += 7) {
+            const auto byte = static_cast<std::uint8_t>(data_.at(pos_++));
+            value |= std::uint64_t(byte & 0x7F) << shift;
+            if(!(byte & 0x80)) {
+                return value;
+            }
+        }
+    }
+
+    std::uint8_t U8() {
+        return static_cast<std::uint8_t>(data_.at(pos_++));
+    }
+
+    std::int16_t I16() {
+        return static_cast<std::int16_t>(Fixed(2));
+    }
+
+    std::int32_t I32() {
+        return static_cast<std::int32_t>(Fixed(4));
+    }
+
+    bool AtEnd() const {
+        return pos_ == data_.size();
+    }
+
+private:
+    const std::string& data_;
+    size_t pos_ = 0;
+
+    std::uint64_t Fixed(size_t size) {
+        std::uint64_t value = 0;
+        for(size_t i = 0; i < size; ++i) {
+            value |= std::uint64_t(static_cast<std::uint8_t>(data_.at(pos_++))) << (8 * i);
+        }
+        return value;
+    }
+};
+
+}  // namespace
+
+SCENARIO("Binary state encoding") {
+    GIVEN("a snapshot with dogs and lost objects") {
+        model::SessionSnapshot snapshot;
+        snapshot.version = 300;
+
+        model::SessionSnapshot::DogInfo dog;
+        dog.id    = model::Dog::Id{5};
+        dog.pos   = {12.3456, -0.5};
+        dog.speed = {-2.5, 0.0};
+        dog.dir   = model::Direction::LEFT;
+        dog.bag   = {{1ull << 32, 2}};
+        dog.score = 130;
+        snapshot.dogs.push_back(dog);
+
+        snapshot.loot.push_back({model::LostObjects::Id{7}, {3.0, 4.0006}, 1});
+
+        WHEN("it is encoded") {
+            std::string data;
+            app::EncodeStateBinary(snapshot, data);
+            Reader reader{data};
+
+            THEN("the header holds the format version, tick and record counts") {
+                CHECK(reader.U8() == app::STATE_BINARY_VERSION);
+                CHECK(reader.Varint() == 300);
+                CHECK(reader.Varint() == 1);
+                CHECK(reader.Varint() == 1);
+
+                AND_THEN("dog fields are quantized to fixed point") {
+                    CHECK(reader.Varint() == 5);
+                    CHECK(reader.I32() == 12346);
+                    CHECK(reader.I32() == -500);
+                    CHECK(reader.I16() == -640);
+                    CHECK(reader.I16() == 0);
+                    CHECK(reader.U8() == static_cast<std::uint8_t>(model::Direction::LEFT));
+                    CHECK(reader.Varint() == 130);
+                    CHECK(reader.Varint() == 1);
+                    CHECK(reader.Varint() == (1ull << 32));
+                    CHECK(reader.Varint() == 2);
+
+                    AND_THEN("lost objects follow the dogs") {
+                        CHECK(reader.Varint() == 7);
+                        CHECK(reader.Varint() == 1);
+                        CHECK(reader.I32() == 3000);
+                        CHECK(reader.I32() == 4001);
+                        CHECK(reader.AtEnd());
+                    }
+                }
+            }
+        }
+    }
+
+    GIVEN("a speed beyond the fixed point range") {
+        model::SessionSnapshot snapshot;
+        model::SessionSnapshot::DogInfo dog;
+        dog.speed = {1000.0, -1000.0};
+        snapshot.dogs.push_back(dog);
+
+        THEN("it is clamped to the range of the field") {
+            std::string data;
+            app::EncodeStateBinary(snapshot, data);
+            Reader reader{data};
+            reader.U8();
+            reader.Varint();
+            reader.Varint();
+            reader.Varint();
+            reader.Varint();
+            reader.I32();
+            reader.I32();
+            CHECK(reader.I16() == INT16_MAX);
+            CHECK(reader.I16() == INT16_MIN);
+        }
+    }
+}
+
+SCENARIO("Choosing the state representation by Accept") {
+    using http_handler::AcceptQuality;
+    const std::string_view binary = app::STATE_BINARY_CONTENT_TYPE;
+    const std::string_view json = "application/json";
+
+    GIVEN("media ranges without weights") {
+        const std::string_view accept = "application/json, application/x-dog-state";
+        THEN("both types are accepted with weight 1") {
+            CHECK(AcceptQuality(accept, binary) == 1.0);
+            CHECK(AcceptQuality(accept, json) == 1.0);
+        }
+    }
+
+    GIVEN("a range with q=0") {
+        const std::string_view accept = "application/x-dog-state;q=0, application/json";
+        THEN("the type is not accepted") {
+            CHECK(AcceptQuality(accept, binary) == 0.0);
+            CHECK(AcceptQuality(accept, json) == 1.0);
+        }
+    }
+
+    GIVEN("wildcards and a more specific range") {
+        const std::string_view accept = "*/*;q=0.8, application/*;q=0.5, Application/X-Dog-State ; Q=0.2";
+        THEN("the most specific matching range wins regardless of order and case") {
+            CHECK(AcceptQuality(accept, binary) == 0.2);
+            CHECK(AcceptQuality(accept, json) == 0.5);
+            CHECK(AcceptQuality(accept, "text/html") == 0.8);
+        }
+    }
+
+    GIVEN("no matching range") {
+        THEN("the weight is 0") {
+            CHECK(AcceptQuality("text/html", binary) == 0.0);
+            CHECK(AcceptQuality("", binary) == 0.0);
+        }
+    }
+}
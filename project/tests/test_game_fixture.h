@@ -0,0 +1,53 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "../src/Players.h"
+
+// Общие заготовки тестов, которые моделируют игру через model::Game и app::Application
+namespace test_game {
+
+// Ушедшие игроки никуда не записываются
+struct NullUseCases : app::UseCases {
+    void AddRetiredPLayer(const std::string&, const double, const double) override {
+    }
+    std::vector<app::detail::RetiredPlayerInfo> GetRetiredPlayer(const double, const double) override {
+        return {};
+    }
+};
+
+// Карта из заданных дорог с одним типом предметов, собаки движутся со скоростью 1
+inline model::Map MakeMap(std::initializer_list<model::Road> roads) {
+    boost::json::array loot_types;
+    loot_types.emplace_back(boost::json::object{{"name", "key"}, {"value", 10}});
+    model::Map map{model::Map::Id{"map"}, "map", "{}", extra_data::LootTypes{std::move(loot_types)}};
+    for (const auto& road : roads) {
+        map.AddRoad(road);
+    }
+    map.SetDogSpeed(1.0);
+    map.SetBagCapacity(3);
+    map.CompileGeometry();
+    return map;
+}
+
+// Сетка дорог 40x40 с шагом 5, двумя типами предметов и двумя офисами
+inline model::Map MakeGridMap() {
+    boost::json::array loot_types;
+    loot_types.emplace_back(boost::json::object{{"name", "key"}, {"value", 10}});
+    loot_types.emplace_back(boost::json::object{{"name", "wallet"}, {"value", 30}});
+    model::Map map{model::Map::Id{"map"}, "map", "{}", extra_data::LootTypes{std::move(loot_types)}};
+    constexpr int GRID = 40;
+    for (int i = 0; i <= GRID; i += 5) {
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, i}, GRID});
+        map.AddRoad(model::Road{model::Road::VERTICAL, {i, 0}, GRID});
+    }
+    map.AddOffice(model::Office{model::Office::Id{"o1"}, {10, 10}, {0, 0}});
+    map.AddOffice(model::Office{model::Office::Id{"o2"}, {30, 25}, {0, 0}});
+    map.SetBagCapacity(3);
+    map.CompileGeometry();
+    return map;
+}
+
+}  // namespace test_game
@@ -0,0 +1,98 @@
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_game_fixture.h"
+
+using namespace std::literals;
+using test_game::MakeGridMap;
+using test_game::NullUseCases;
+
+namespace {
+// Подсчёт обращений к куче включается только на время проверяемых тиков
+std::atomic<bool> count_allocations{false};
+std::atomic<size_t> allocations{0};
+
+void* Allocate(std::size_t size, std::size_t alignment) {
+    if (count_allocations.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+    if (void* p = std::aligned_alloc(alignment, size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+    return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return Allocate(size, std::max(static_cast<std::size_t>(alignment), alignof(std::max_align_t)));
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+SCENARIO("Steady-state game tick") {
+    GIVEN("a session with moving dogs, loot and offices") {
+        auto loot_generator = std::make_shared<loot_gen::LootGenerator>(500ms, 0.5);
+        model::Game game{loot_generator};
+        game.SetDogRetirementTime(1e6);
+        game.SetRandomSeed(42);
+        game.AddMap(MakeGridMap());
+
+        NullUseCases use_cases;
+        app::Application app{game, std::make_shared<app::PlayerTokens>(), std::make_shared<app::Players>(),
+                             true, true, use_cases};
+
+        constexpr size_t DOGS = 100;
+        std::vector<std::shared_ptr<model::Dog>> dogs;
+        std::shared_ptr<model::GameSession> session;
+        for (size_t i = 0; i < DOGS; ++i) {
+            dogs.emplace_back(std::make_shared<model::Dog>(model::Dog::Id{i}, "dog"s));
+            session = game.ConnectToSession(model::Map::Id{"map"}, dogs.back(), true);
+        }
+
+        // Собаки по очереди меняют направление, подбирают предметы и сдают их в офисы
+        util::RandomEngine random{7};
+        const auto play = [&](int ticks) {
+            for (int tick = 0; tick < ticks; ++tick) {
+                const auto& dog = dogs[random.NextBelow(DOGS)];
+                session->SetDogDir(*dog, static_cast<model::Direction>(1 + random.NextBelow(4)));
+                app.Tick(50);
+            }
+        };
+
+        WHEN("buffers have grown during warm-up") {
+            play(5000);
+            REQUIRE(session->LootCount() > 0);
+
+            THEN("ticks do not allocate memory") {
+                allocations = 0;
+                count_allocations = true;
+                play(1000);
+                count_allocations = false;
+                CHECK(allocations == 0);
+            }
+        }
+    }
+}